@@ -0,0 +1,145 @@
+#include "connection_scan.h"
+#include <algorithm>
+#include <climits>
+
+static const int SECONDS_PER_DAY = 24 * 3600;
+
+ConnectionScanRouter::ConnectionScanRouter(const Timetable& timetable, const MetroGraph& metroGraph) : graph(metroGraph) {
+    // Keep the trips whose stops are all in the graph
+    std::vector<const TimetableTrip*> trips;
+    for (const TimetableTrip& trip : timetable.trips) {
+        bool known = trip.stopIds.size() >= 2;
+        for (size_t s = 0; s < trip.stopIds.size() && known; s++) {
+            known = graph.getStationIndex(trip.stopIds[s]) >= 0;
+        }
+        if (known) {
+            trips.push_back(&trip);
+        }
+    }
+
+    int tripCount = static_cast<int>(trips.size());
+    for (int t = 0; t < tripCount; t++) {
+        const TimetableTrip& trip = *trips[t];
+        tripLines.push_back(trip.routeId);
+        // A trip without a known service is assumed to run every day
+        tripWeekdays.push_back(trip.serviceIndex >= 0 ?
+            timetable.services[trip.serviceIndex].weekdays : static_cast<uint8_t>(0x7F));
+
+        for (size_t s = 0; s + 1 < trip.stopIds.size(); s++) {
+            Connection connection{trip.departureTimes[s], trip.arrivalTimes[s + 1],
+                                  graph.getStationIndex(trip.stopIds[s]), graph.getStationIndex(trip.stopIds[s + 1]), t};
+            connections.push_back(connection);
+
+            // Rides after midnight also run early on the next calendar day
+            if (connection.departure >= SECONDS_PER_DAY) {
+                connection.departure -= SECONDS_PER_DAY;
+                connection.arrival -= SECONDS_PER_DAY;
+                connection.trip += tripCount;
+                connections.push_back(connection);
+            }
+        }
+    }
+
+    std::sort(connections.begin(), connections.end(), [](const Connection& a, const Connection& b) {
+        return a.departure != b.departure ? a.departure < b.departure : a.arrival < b.arrival;
+    });
+}
+
+TimetableJourney ConnectionScanRouter::findEarliestArrival(int sourceId, int targetId, int departureTime, int dayOfWeek,
+                                                           int changeSeconds) const {
+    TimetableJourney journey;
+    int sourceIndex = graph.getStationIndex(sourceId);
+    int targetIndex = graph.getStationIndex(targetId);
+    if (sourceIndex < 0 || targetIndex < 0 || dayOfWeek < 0 || dayOfWeek > 6) {
+        return journey;
+    }
+
+    if (sourceIndex == targetIndex) {
+        journey.path.stationIds.push_back(sourceId);
+        journey.departureTime = departureTime;
+        journey.arrivalTime = departureTime;
+        return journey;
+    }
+
+    int tripCount = getTripCount();
+    uint8_t todayBit = static_cast<uint8_t>(1 << dayOfWeek);
+    uint8_t yesterdayBit = static_cast<uint8_t>(1 << ((dayOfWeek + 6) % 7));
+
+    std::vector<int> arrival(graph.getStationCount(), INT_MAX);
+    std::vector<int> arrivalConnection(graph.getStationCount(), -1);
+    std::vector<int> boardConnection(static_cast<size_t>(tripCount) * 2, -1);
+    arrival[sourceIndex] = departureTime;
+
+    size_t first = std::partition_point(connections.begin(), connections.end(), [&](const Connection& c) {
+        return c.departure < departureTime;
+    }) - connections.begin();
+
+    // Nothing departing after the best arrival at the target can improve it
+    for (size_t i = first; i < connections.size() && connections[i].departure < arrival[targetIndex]; i++) {
+        const Connection& connection = connections[i];
+        if (boardConnection[connection.trip] < 0) {
+            bool yesterday = connection.trip >= tripCount;
+            uint8_t weekdays = tripWeekdays[yesterday ? connection.trip - tripCount : connection.trip];
+            if (!(weekdays & (yesterday ? yesterdayBit : todayBit))) {
+                continue;
+            }
+            int reached = arrival[connection.fromStation];
+            if (reached == INT_MAX ||
+                reached + (connection.fromStation == sourceIndex ? 0 : changeSeconds) > connection.departure) {
+                continue;
+            }
+            boardConnection[connection.trip] = static_cast<int>(i);
+        }
+
+        if (connection.arrival < arrival[connection.toStation]) {
+            arrival[connection.toStation] = connection.arrival;
+            arrivalConnection[connection.toStation] = static_cast<int>(i);
+        }
+    }
+
+    if (arrival[targetIndex] == INT_MAX) {
+        return journey;
+    }
+
+    // Walk the rides back from the target as (board, alight) connection pairs
+    std::vector<std::pair<int, int>> rides;
+    for (int station = targetIndex; station != sourceIndex; ) {
+        int alight = arrivalConnection[station];
+        int board = boardConnection[connections[alight].trip];
+        rides.emplace_back(board, alight);
+        station = connections[board].fromStation;
+    }
+    std::reverse(rides.begin(), rides.end());
+
+    MetroPath& path = journey.path;
+    path.stationIds.push_back(sourceIndex);
+    int previousLine = -1;
+    for (const std::pair<int, int>& ride : rides) {
+        int trip = connections[ride.first].trip;
+        int lineId = tripLines[trip < tripCount ? trip : trip - tripCount];
+        if (previousLine >= 0 && graph.isInterchange(previousLine, lineId)) {
+            path.interchangeCount++;
+        }
+        previousLine = lineId;
+
+        // The trip's own connections between boarding and alighting, in order
+        for (int i = ride.first; i <= ride.second; i++) {
+            if (connections[i].trip != trip) {
+                continue;
+            }
+            int station = connections[i].toStation;
+            path.totalDistance += graph.getStraightLineDistance(path.stationIds.back(), station);
+            path.stationIds.push_back(station);
+            path.lineIds.push_back(lineId);
+        }
+    }
+    for (int& station : path.stationIds) {
+        station = graph.getStationIdAt(station);
+    }
+
+    journey.departureTime = connections[rides.front().first].departure;
+    journey.arrivalTime = arrival[targetIndex];
+    journey.rounds = static_cast<int>(rides.size());
+    path.totalTime = (journey.arrivalTime - departureTime) / 60.0;
+    return journey;
+}
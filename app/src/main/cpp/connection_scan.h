@@ -0,0 +1,43 @@
+#ifndef CONNECTION_SCAN_H
+#define CONNECTION_SCAN_H
+
+#include "metro_graph.h"
+#include "raptor_router.h"
+#include "timetable.h"
+#include <cstdint>
+#include <vector>
+
+// Earliest-arrival router using the Connection Scan Algorithm: every ride between
+// two consecutive stops of a trip is one connection, and all connections sit in a
+// single array sorted by departure, so a query is one forward sweep over it.
+class ConnectionScanRouter {
+private:
+    struct Connection {
+        int departure;
+        int arrival;
+        int fromStation;        // Dense station indices
+        int toStation;
+        int trip;               // Index into tripLines/tripWeekdays; + tripCount for the
+                                // previous service day's copy, shifted back 24 hours
+    };
+
+    const MetroGraph& graph;
+    std::vector<Connection> connections;
+    std::vector<int> tripLines;
+    std::vector<uint8_t> tripWeekdays;      // Weekday bits of each trip's service
+
+public:
+    // Build the sorted connection array for a frozen graph; trips with stops the
+    // graph doesn't know are skipped
+    ConnectionScanRouter(const Timetable& timetable, const MetroGraph& metroGraph);
+
+    int getConnectionCount() const { return static_cast<int>(connections.size()); }
+    int getTripCount() const { return static_cast<int>(tripLines.size()); }
+
+    // Same query and answer as RaptorRouter::findEarliestArrival, without a limit on
+    // the number of trains
+    TimetableJourney findEarliestArrival(int sourceId, int targetId, int departureTime, int dayOfWeek,
+                                         int changeSeconds = RaptorRouter::DEFAULT_CHANGE_SECONDS) const;
+};
+
+#endif // CONNECTION_SCAN_H
@@ -0,0 +1,446 @@
+#include "contraction_hierarchy.h"
+#include "cost_policy.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <utility>
+
+// Witness searches stop after settling this many nodes; a missed witness
+// only costs an unnecessary shortcut, never a wrong answer. Priority
+// estimates use a much smaller limit than the real contraction.
+static const int maxWitnessSettled = 100;
+static const int maxEstimateWitnessSettled = 10;
+
+ContractionHierarchy::ContractionHierarchy(const MetroGraph& metroGraph, bool useDistance)
+    : graph(metroGraph), useDistance(useDistance) {
+    nodeCount = useDistance ? graph.getStationCount() : graph.getStateCount();
+    addOriginalArcs();
+    if (!useDistance) {
+        addFirstRides();
+    }
+    contractNodes();
+    buildSearchGraphs();
+}
+
+void ContractionHierarchy::addOriginalArcs() {
+    // Index of the arc already added from the current node to each head, stamped by tail
+    std::vector<int> arcTo(nodeCount, -1);
+    std::vector<int> arcToStamp(nodeCount, -1);
+
+    for (int node = 0; node < nodeCount; node++) {
+        int station = useDistance ? node : graph.getStateStation(node);
+
+        for (const CsrEdge& edge : graph.getEdges(station)) {
+            int head;
+            double weight;
+            if (useDistance) {
+                head = edge.targetIndex;
+                weight = edge.distance;
+            } else {
+                head = graph.getEdgeTargetState(graph.getEdgeIndex(edge));
+                weight = edge.time;
+                if (graph.isInterchangeAt(graph.getStateLine(node), edge.lineIndex)) {
+                    weight += INTERCHANGE_PENALTY_MINUTES;
+                }
+            }
+            if (head == node) {
+                continue;
+            }
+
+            // Parallel edges collapse into one arc with the cheapest weight
+            if (arcToStamp[head] == node) {
+                Arc& arc = arcs[arcTo[head]];
+                arc.weight = std::min(arc.weight, weight);
+                continue;
+            }
+            arcToStamp[head] = node;
+            arcTo[head] = static_cast<int>(arcs.size());
+            arcs.push_back(Arc{node, head, weight, -1, -1});
+        }
+    }
+}
+
+void ContractionHierarchy::addFirstRides() {
+    int stationCount = graph.getStationCount();
+    std::vector<int> rideTo(nodeCount, -1);
+    firstRideOffsets.assign(stationCount + 1, 0);
+
+    for (int station = 0; station < stationCount; station++) {
+        size_t first = firstRides.size();
+        for (const CsrEdge& edge : graph.getEdges(station)) {
+            int state = graph.getEdgeTargetState(graph.getEdgeIndex(edge));
+            if (rideTo[state] >= static_cast<int>(first)) {
+                Arc& ride = firstRides[rideTo[state]];
+                ride.weight = std::min(ride.weight, edge.time);
+                continue;
+            }
+            rideTo[state] = static_cast<int>(firstRides.size());
+            firstRides.push_back(Arc{station, state, edge.time, -1, -1});
+        }
+        firstRideOffsets[station + 1] = static_cast<int>(firstRides.size());
+    }
+}
+
+void ContractionHierarchy::contractNodes() {
+    const double infinity = std::numeric_limits<double>::infinity();
+
+    // Arcs between uncontracted nodes, by tail and by head
+    std::vector<std::vector<int>> outArcs(nodeCount);
+    std::vector<std::vector<int>> inArcs(nodeCount);
+    for (size_t i = 0; i < arcs.size(); i++) {
+        outArcs[arcs[i].from].push_back(static_cast<int>(i));
+        inArcs[arcs[i].to].push_back(static_cast<int>(i));
+    }
+
+    std::vector<int> contractedNeighbors(nodeCount, 0);
+    rank.assign(nodeCount, -1);
+
+    // Scratch state for witness searches
+    std::vector<double> witnessDist(nodeCount, infinity);
+    std::vector<int> witnessTouched;
+    std::vector<std::pair<double, int>> witnessHeap;
+    std::greater<> heapCompare;
+
+    // Cheapest arc per neighbour (parallel arcs appear once shortcuts exist)
+    std::vector<int> cheapestArc(nodeCount, -1);
+    auto cheapestArcs = [&](const std::vector<int>& candidates, bool byTail) {
+        std::vector<int> result;
+        for (int arcIndex : candidates) {
+            int neighbour = byTail ? arcs[arcIndex].from : arcs[arcIndex].to;
+            int& slot = cheapestArc[neighbour];
+            if (slot < 0) {
+                slot = static_cast<int>(result.size());
+                result.push_back(arcIndex);
+            } else if (arcs[arcIndex].weight < arcs[result[slot]].weight) {
+                result[slot] = arcIndex;
+            }
+        }
+        for (int arcIndex : result) {
+            cheapestArc[byTail ? arcs[arcIndex].from : arcs[arcIndex].to] = -1;
+        }
+        return result;
+    };
+
+    // Bounded Dijkstra from a node over uncontracted nodes, avoiding the one being contracted
+    auto witnessSearch = [&](int start, int avoided, double maxCost, int maxSettled) {
+        for (int node : witnessTouched) {
+            witnessDist[node] = infinity;
+        }
+        witnessTouched.clear();
+        witnessHeap.clear();
+
+        witnessDist[start] = 0;
+        witnessTouched.push_back(start);
+        witnessHeap.emplace_back(0, start);
+        int settled = 0;
+
+        while (!witnessHeap.empty() && settled < maxSettled) {
+            std::pop_heap(witnessHeap.begin(), witnessHeap.end(), heapCompare);
+            std::pair<double, int> top = witnessHeap.back();
+            witnessHeap.pop_back();
+
+            if (top.first > witnessDist[top.second]) {
+                continue;
+            }
+            if (top.first > maxCost) {
+                break;
+            }
+            settled++;
+
+            for (int arcIndex : outArcs[top.second]) {
+                int head = arcs[arcIndex].to;
+                if (head == avoided) {
+                    continue;
+                }
+                double cost = top.first + arcs[arcIndex].weight;
+                if (cost < witnessDist[head]) {
+                    if (witnessDist[head] == infinity) {
+                        witnessTouched.push_back(head);
+                    }
+                    witnessDist[head] = cost;
+                    witnessHeap.emplace_back(cost, head);
+                    std::push_heap(witnessHeap.begin(), witnessHeap.end(), heapCompare);
+                }
+            }
+        }
+    };
+
+    // Shortcuts needed to contract a node, added to the graph when apply is set
+    auto contractNode = [&](int node, bool apply, int& removedArcs) {
+        std::vector<int> incoming = cheapestArcs(inArcs[node], true);
+        std::vector<int> outgoing = cheapestArcs(outArcs[node], false);
+        removedArcs = static_cast<int>(incoming.size() + outgoing.size());
+
+        double maxOutgoing = 0;
+        for (int arcIndex : outgoing) {
+            maxOutgoing = std::max(maxOutgoing, arcs[arcIndex].weight);
+        }
+
+        int shortcuts = 0;
+        for (int inIndex : incoming) {
+            int tail = arcs[inIndex].from;
+            double inWeight = arcs[inIndex].weight;
+            witnessSearch(tail, node, inWeight + maxOutgoing, apply ? maxWitnessSettled : maxEstimateWitnessSettled);
+
+            for (int outIndex : outgoing) {
+                int head = arcs[outIndex].to;
+                if (head == tail) {
+                    continue;
+                }
+
+                // Keep the path through this node unless another path is no longer
+                double weight = inWeight + arcs[outIndex].weight;
+                if (witnessDist[head] <= weight) {
+                    continue;
+                }
+                shortcuts++;
+
+                if (apply) {
+                    int shortcutIndex = static_cast<int>(arcs.size());
+                    arcs.push_back(Arc{tail, head, weight, inIndex, outIndex});
+                    outArcs[tail].push_back(shortcutIndex);
+                    inArcs[head].push_back(shortcutIndex);
+                }
+            }
+        }
+        return shortcuts;
+    };
+
+    // Edge difference plus contracted neighbours, so contraction spreads over the network
+    auto priority = [&](int node) {
+        int removedArcs = 0;
+        int shortcuts = contractNode(node, false, removedArcs);
+        return shortcuts - removedArcs + contractedNeighbors[node];
+    };
+
+    std::vector<std::pair<int, int>> queue;
+    for (int node = 0; node < nodeCount; node++) {
+        queue.emplace_back(priority(node), node);
+    }
+    std::make_heap(queue.begin(), queue.end(), heapCompare);
+
+    int nextRank = 0;
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), heapCompare);
+        int node = queue.back().second;
+        queue.pop_back();
+
+        // Lazy update: priorities only grow stale upwards, so re-check against the next entry
+        int current = priority(node);
+        if (!queue.empty() && current > queue.front().first) {
+            queue.emplace_back(current, node);
+            std::push_heap(queue.begin(), queue.end(), heapCompare);
+            continue;
+        }
+
+        int removedArcs = 0;
+        size_t firstShortcut = arcs.size();
+        contractNode(node, true, removedArcs);
+        shortcutCount += static_cast<int>(arcs.size() - firstShortcut);
+
+        rank[node] = nextRank++;
+        
+        // Drop the node from its neighbours' arc lists so later searches skip it,
+        // and keep only the cheapest of any parallel arcs left there
+        auto touchesNode = [&](int arcIndex) {
+            return arcs[arcIndex].from == node || arcs[arcIndex].to == node;
+        };
+        for (int arcIndex : cheapestArcs(outArcs[node], false)) {
+            std::vector<int>& headArcs = inArcs[arcs[arcIndex].to];
+            headArcs.erase(std::remove_if(headArcs.begin(), headArcs.end(), touchesNode), headArcs.end());
+            headArcs = cheapestArcs(headArcs, true);
+            contractedNeighbors[arcs[arcIndex].to]++;
+        }
+        for (int arcIndex : cheapestArcs(inArcs[node], true)) {
+            std::vector<int>& tailArcs = outArcs[arcs[arcIndex].from];
+            tailArcs.erase(std::remove_if(tailArcs.begin(), tailArcs.end(), touchesNode), tailArcs.end());
+            tailArcs = cheapestArcs(tailArcs, false);
+            contractedNeighbors[arcs[arcIndex].from]++;
+        }
+    }
+}
+
+void ContractionHierarchy::buildSearchGraphs() {
+    upOffsets.assign(nodeCount + 1, 0);
+    downOffsets.assign(nodeCount + 1, 0);
+
+    // Count, prefix-sum, then fill, as for the graph's CSR
+    for (const Arc& arc : arcs) {
+        if (rank[arc.from] < rank[arc.to]) {
+            upOffsets[arc.from + 1]++;
+        } else {
+            downOffsets[arc.to + 1]++;
+        }
+    }
+    for (int node = 0; node < nodeCount; node++) {
+        upOffsets[node + 1] += upOffsets[node];
+        downOffsets[node + 1] += downOffsets[node];
+    }
+
+    upArcs.resize(upOffsets[nodeCount]);
+    downArcs.resize(downOffsets[nodeCount]);
+    std::vector<int> upFill(upOffsets.begin(), upOffsets.end() - 1);
+    std::vector<int> downFill(downOffsets.begin(), downOffsets.end() - 1);
+    for (size_t i = 0; i < arcs.size(); i++) {
+        const Arc& arc = arcs[i];
+        if (rank[arc.from] < rank[arc.to]) {
+            upArcs[upFill[arc.from]++] = static_cast<int>(i);
+        } else {
+            downArcs[downFill[arc.to]++] = static_cast<int>(i);
+        }
+    }
+}
+
+void ContractionHierarchy::unpackArc(int arcIndex, std::vector<int>& nodes) const {
+    const Arc& arc = arcs[arcIndex];
+    if (arc.firstChild < 0) {
+        nodes.push_back(arc.to);
+        return;
+    }
+    unpackArc(arc.firstChild, nodes);
+    unpackArc(arc.secondChild, nodes);
+}
+
+double ContractionHierarchy::findPath(int sourceIndex, int targetIndex, QueryWorkspace& workspace,
+                                      MetroPath& path) const {
+    QueryWorkspace& forward = workspace;
+    QueryWorkspace& backward = workspace.backward();
+    forward.begin(nodeCount);
+    backward.begin(nodeCount);
+
+    std::greater<> heapCompare;
+    const double infinity = std::numeric_limits<double>::infinity();
+    double best = infinity;
+    int meetNode = -1;
+
+    // The workspace's line slot holds the arc each node was reached by
+    auto relax = [&](QueryWorkspace& side, QueryWorkspace& other, int node, double cost, int prevNode, int arcIndex) {
+        side.stats.relaxedEdges++;
+        if (side.getDist(node) <= cost) {
+            return;
+        }
+        side.setDist(node, cost, prevNode, arcIndex);
+        side.heap.push_back(DijkstraNode(node, cost, prevNode, arcIndex));
+        std::push_heap(side.heap.begin(), side.heap.end(), heapCompare);
+        side.stats.heapPushes++;
+
+        double total = cost + other.getDist(node);
+        if (total < best) {
+            best = total;
+            meetNode = node;
+        }
+    };
+
+    if (useDistance) {
+        relax(forward, backward, sourceIndex, 0, -1, -1);
+        relax(backward, forward, targetIndex, 0, -1, -1);
+    } else {
+        // The first ride from the source never pays an interchange penalty,
+        // and arriving at the target on any line ends the trip
+        for (int i = firstRideOffsets[sourceIndex]; i < firstRideOffsets[sourceIndex + 1]; i++) {
+            relax(forward, backward, firstRides[i].to, firstRides[i].weight, -1, -1);
+        }
+        for (int state = graph.getFirstState(targetIndex); state < graph.getEndState(targetIndex); state++) {
+            relax(backward, forward, state, 0, -1, -1);
+        }
+    }
+
+    // Both searches only climb the hierarchy; they meet at the highest node of the path
+    while (!forward.heap.empty() || !backward.heap.empty()) {
+        double topForward = forward.heap.empty() ? infinity : forward.heap.front().cost;
+        double topBackward = backward.heap.empty() ? infinity : backward.heap.front().cost;
+        if (std::min(topForward, topBackward) >= best) {
+            break;
+        }
+
+        bool expandForward = topForward <= topBackward;
+        QueryWorkspace& side = expandForward ? forward : backward;
+        std::pop_heap(side.heap.begin(), side.heap.end(), heapCompare);
+        int node = side.heap.back().stationId;
+        side.heap.pop_back();
+        side.stats.heapPops++;
+
+        if (side.isSettled(node)) {
+            continue;
+        }
+        side.markSettled(node);
+        side.stats.settledNodes++;
+
+        double nodeCost = side.getDist(node);
+        
+        // Stall on demand: a node reached more cheaply through a higher node
+        // that the search came down from can't be on the shortest path
+        bool stalled = false;
+        if (expandForward) {
+            for (int i = downOffsets[node]; i < downOffsets[node + 1] && !stalled; i++) {
+                const Arc& arc = arcs[downArcs[i]];
+                stalled = forward.getDist(arc.from) + arc.weight < nodeCost;
+            }
+        } else {
+            for (int i = upOffsets[node]; i < upOffsets[node + 1] && !stalled; i++) {
+                const Arc& arc = arcs[upArcs[i]];
+                stalled = backward.getDist(arc.to) + arc.weight < nodeCost;
+            }
+        }
+        if (stalled) {
+            continue;
+        }
+        
+        if (expandForward) {
+            for (int i = upOffsets[node]; i < upOffsets[node + 1]; i++) {
+                const Arc& arc = arcs[upArcs[i]];
+                relax(forward, backward, arc.to, nodeCost + arc.weight, node, upArcs[i]);
+            }
+        } else {
+            for (int i = downOffsets[node]; i < downOffsets[node + 1]; i++) {
+                const Arc& arc = arcs[downArcs[i]];
+                relax(backward, forward, arc.from, nodeCost + arc.weight, node, downArcs[i]);
+            }
+        }
+    }
+
+    forward.stats.settledNodes += backward.stats.settledNodes;
+    forward.stats.relaxedEdges += backward.stats.relaxedEdges;
+    forward.stats.heapPushes += backward.stats.heapPushes;
+    forward.stats.heapPops += backward.stats.heapPops;
+
+    if (meetNode < 0) {
+        return infinity;
+    }
+
+    // Arcs from the forward root up to the meeting node, then down to the target
+    std::vector<int> pathArcs;
+    for (int node = meetNode; forward.getPrevLine(node) != -1; node = forward.getPrevNode(node)) {
+        pathArcs.push_back(forward.getPrevLine(node));
+    }
+    std::reverse(pathArcs.begin(), pathArcs.end());
+    for (int node = meetNode; backward.getPrevLine(node) != -1; node = backward.getPrevNode(node)) {
+        pathArcs.push_back(backward.getPrevLine(node));
+    }
+
+    // Node sequence of the path in the original graph
+    std::vector<int> nodes;
+    int rootNode = meetNode;
+    while (forward.getPrevNode(rootNode) != -1) {
+        rootNode = forward.getPrevNode(rootNode);
+    }
+    nodes.push_back(rootNode);
+    for (int arcIndex : pathArcs) {
+        unpackArc(arcIndex, nodes);
+    }
+
+    path.stationIds.clear();
+    path.lineIds.clear();
+    if (useDistance) {
+        path.stationIds = nodes;
+    } else {
+        // The forward root is the state reached by the first ride from the source
+        path.stationIds.push_back(sourceIndex);
+        for (int state : nodes) {
+            path.stationIds.push_back(graph.getStateStation(state));
+            path.lineIds.push_back(graph.getStateLine(state));
+        }
+    }
+
+    return best;
+}
@@ -0,0 +1,72 @@
+#ifndef CONTRACTION_HIERARCHY_H
+#define CONTRACTION_HIERARCHY_H
+
+#include "metro_graph.h"
+#include "query_workspace.h"
+#include <vector>
+
+// Contraction hierarchy over a frozen MetroGraph for one metric. Distance
+// hierarchies use stations as nodes; time hierarchies use the line-aware
+// (station, arriving line) states, so the interchange penalty is part of the
+// arc weights and stays exact after contraction.
+class ContractionHierarchy {
+private:
+    // Arc between two nodes; a shortcut keeps the two arcs it replaces
+    struct Arc {
+        int from;
+        int to;
+        double weight;
+        int firstChild;     // -1 for arcs of the original graph
+        int secondChild;
+    };
+
+    const MetroGraph& graph;
+    bool useDistance;
+    int nodeCount = 0;
+    int shortcutCount = 0;
+    std::vector<Arc> arcs;
+    std::vector<int> rank;              // contraction order of each node
+
+    // Arcs the forward search follows (to a higher node), grouped by tail, and
+    // arcs the backward search follows (from a higher node), grouped by head
+    std::vector<int> upOffsets;         // size = node count + 1
+    std::vector<int> upArcs;
+    std::vector<int> downOffsets;       // size = node count + 1
+    std::vector<int> downArcs;
+
+    // Time hierarchies: the states reachable by a first ride from each station,
+    // with the cheapest time of the parallel edges (from holds the station)
+    std::vector<int> firstRideOffsets;  // size = station count + 1
+    std::vector<Arc> firstRides;
+
+    // One arc per connected node pair, with the cheapest weight of its parallel edges
+    void addOriginalArcs();
+
+    // Collapse each station's edges into first rides (time hierarchies only)
+    void addFirstRides();
+
+    // Contract all nodes in edge-difference order, adding shortcuts as needed
+    void contractNodes();
+
+    // Split the arcs into the upward and downward search graphs by rank
+    void buildSearchGraphs();
+
+    // Append the head nodes of the original arcs behind an arc
+    void unpackArc(int arcIndex, std::vector<int>& nodes) const;
+
+public:
+    // Preprocess a frozen graph; takes time, so build once and reuse
+    ContractionHierarchy(const MetroGraph& metroGraph, bool useDistance);
+
+    // Number of search nodes and of shortcut arcs added by contraction
+    int getNodeCount() const { return nodeCount; }
+    int getShortcutCount() const { return shortcutCount; }
+
+    // Query between two dense station indices (different stations). Fills
+    // path.stationIds with dense station indices and, for time hierarchies,
+    // path.lineIds with dense line indices; returns the cost, or infinity if
+    // the target can't be reached
+    double findPath(int sourceIndex, int targetIndex, QueryWorkspace& workspace, MetroPath& path) const;
+};
+
+#endif // CONTRACTION_HIERARCHY_H
@@ -0,0 +1,72 @@
+#ifndef COST_POLICY_H
+#define COST_POLICY_H
+
+#include "metro_graph.h"
+
+// Minutes added to the time of a path for each change between real lines, by every
+// engine that searches by time
+constexpr double INTERCHANGE_PENALTY_MINUTES = 8.0;
+
+// What the cost of a search adds up to, which decides how path totals are filled
+enum class PathCost {
+    Distance,   // Km; the cost is the path's totalDistance
+    Time,       // Minutes with the interchange penalty; the cost is the path's totalTime
+    Other       // Anything else; both totals are summed from the path's edges
+};
+
+// Cost policies are the edge weights of a search, passed as a template parameter so
+// each criterion compiles to its own kernel with the weights inlined. A policy has:
+//
+//   static constexpr PathCost metric
+//   static constexpr bool chargesInterchanges   whether interchangeCost() applies at all
+//   double edgeCost(const CsrEdge& edge) const  cost of riding one edge, never negative
+//   double interchangeCost() const              added when changing between real lines
+//   double costPerKm(const MetroGraph&) const   lower bound on the cost of a straight-line
+//                                               km, used by A* (0 turns the bound off)
+//
+// New criteria only need a struct like the ones below.
+
+// Shortest path by distance
+struct DistanceCost {
+    static constexpr PathCost metric = PathCost::Distance;
+    static constexpr bool chargesInterchanges = false;
+
+    double edgeCost(const CsrEdge& edge) const { return edge.distance; }
+    double interchangeCost() const { return 0; }
+    double costPerKm(const MetroGraph& /*graph*/) const { return 1.0; }
+};
+
+// Fastest path by time
+struct TimeCost {
+    static constexpr PathCost metric = PathCost::Time;
+    static constexpr bool chargesInterchanges = true;
+
+    double edgeCost(const CsrEdge& edge) const { return edge.time; }
+    double interchangeCost() const { return INTERCHANGE_PENALTY_MINUTES; }
+
+    // No edge is faster than the fastest edge speed
+    double costPerKm(const MetroGraph& graph) const {
+        return graph.getMaxEdgeSpeed() > 0 ? 1.0 / graph.getMaxEdgeSpeed() : 0;
+    }
+};
+
+// Fastest path for riders who find changing lines hard (lifts, long passages, heavy
+// luggage): each interchange weighs interchangeMinutes in the search, while the path
+// totals still report the real time
+struct AccessibleTimeCost {
+    static constexpr PathCost metric = PathCost::Other;
+    static constexpr bool chargesInterchanges = true;
+    static constexpr double DEFAULT_INTERCHANGE_MINUTES = 30.0;
+
+    double interchangeMinutes;
+
+    explicit AccessibleTimeCost(double minutes = DEFAULT_INTERCHANGE_MINUTES) : interchangeMinutes(minutes) {}
+
+    double edgeCost(const CsrEdge& edge) const { return edge.time; }
+    double interchangeCost() const { return interchangeMinutes; }
+    double costPerKm(const MetroGraph& graph) const {
+        return graph.getMaxEdgeSpeed() > 0 ? 1.0 / graph.getMaxEdgeSpeed() : 0;
+    }
+};
+
+#endif // COST_POLICY_H
@@ -0,0 +1,322 @@
+#include "graph_snapshot.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+static const char GRAPH_SNAPSHOT_MAGIC[4] = {'M', 'G', 'S', 'N'};
+
+// Appends native-endian values and length-prefixed strings to a blob
+class SnapshotWriter {
+private:
+    std::vector<uint8_t>& blob;
+
+public:
+    explicit SnapshotWriter(std::vector<uint8_t>& output) : blob(output) {}
+
+    template <typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be plain data");
+        size_t offset = blob.size();
+        blob.resize(offset + sizeof(T));
+        std::memcpy(blob.data() + offset, &value, sizeof(T));
+    }
+
+    void putString(const std::string& text) {
+        put(static_cast<uint32_t>(text.size()));
+        blob.insert(blob.end(), text.begin(), text.end());
+    }
+
+    template <typename T>
+    void putArray(const std::vector<T>& values) {
+        put(static_cast<uint32_t>(values.size()));
+        for (const T& value : values) {
+            put(value);
+        }
+    }
+};
+
+// Reads back what SnapshotWriter wrote; reading past the end clears ok and yields zeros
+class SnapshotReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+
+public:
+    bool ok = true;
+
+    SnapshotReader(const uint8_t* payload, size_t payloadSize) : data(payload), size(payloadSize) {}
+
+    bool atEnd() const { return position == size; }
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (!ok || size - position < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, data + position, sizeof(T));
+        position += sizeof(T);
+        return value;
+    }
+
+    std::string getString() {
+        uint32_t length = get<uint32_t>();
+        if (!ok || size - position < length) {
+            ok = false;
+            return std::string();
+        }
+        std::string text(reinterpret_cast<const char*>(data + position), length);
+        position += length;
+        return text;
+    }
+
+    template <typename T>
+    void getArray(std::vector<T>& values) {
+        uint32_t count = get<uint32_t>();
+        if (!ok || (size - position) / sizeof(T) < count) {
+            ok = false;
+            return;
+        }
+        values.resize(count);
+        std::memcpy(values.data(), data + position, count * sizeof(T));
+        position += count * sizeof(T);
+    }
+};
+
+uint64_t GraphSnapshot::hashBytes(const void* data, size_t size, uint64_t hash) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    size_t wordEnd = size - size % sizeof(uint64_t);
+    for (size_t i = 0; i < wordEnd; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash ^= word;
+        hash *= 1099511628211ULL;
+    }
+    for (size_t i = wordEnd; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::vector<uint8_t> GraphSnapshot::build(const MetroGraph& graph, const Timetable* timetable, uint64_t sourceHash) {
+    std::vector<uint8_t> blob;
+    if (!graph.isFrozen()) {
+        return blob;
+    }
+    blob.resize(sizeof(GraphSnapshotHeader));
+    SnapshotWriter writer(blob);
+
+    // Stations in dense index order
+    int stationCount = graph.getStationCount();
+    writer.put(static_cast<uint32_t>(stationCount));
+    for (int index = 0; index < stationCount; index++) {
+        const MetroStation* station = graph.getStation(graph.getStationIdAt(index));
+        writer.put(static_cast<int32_t>(station->id));
+        writer.putString(station->code);
+        writer.putString(station->name);
+        writer.put(station->latitude);
+        writer.put(station->longitude);
+    }
+
+    // Lines from routes.txt; IDs only known from edges come back with the edges
+    int lineCount = graph.getLineCount();
+    uint32_t namedLines = 0;
+    for (int index = 0; index < lineCount; index++) {
+        namedLines += graph.getLine(graph.getLineIdAt(index)) ? 1 : 0;
+    }
+    writer.put(namedLines);
+    for (int index = 0; index < lineCount; index++) {
+        const MetroLine* line = graph.getLine(graph.getLineIdAt(index));
+        if (line) {
+            writer.put(static_cast<int32_t>(line->id));
+            writer.putString(line->name);
+            writer.putString(line->color);
+        }
+    }
+
+    // Edges per station in CSR order, so freezing them again gives the same layout
+    for (int index = 0; index < stationCount; index++) {
+        CsrEdgeRange edges = graph.getEdges(index);
+        writer.put(static_cast<uint32_t>(edges.size()));
+        for (const CsrEdge& edge : edges) {
+            writer.put(static_cast<int32_t>(graph.getStationIdAt(edge.targetIndex)));
+            writer.put(static_cast<int32_t>(graph.getLineIdAt(edge.lineIndex)));
+            writer.put(edge.distance);
+            writer.put(edge.time);
+            writer.put(graph.getEdgeTiming(graph.getEdgeIndex(edge)));
+        }
+    }
+
+    if (timetable) {
+        writer.put(static_cast<uint32_t>(timetable->services.size()));
+        for (const TimetableService& service : timetable->services) {
+            writer.putString(service.id);
+            writer.put(service.weekdays);
+            writer.put(static_cast<int32_t>(service.startDate));
+            writer.put(static_cast<int32_t>(service.endDate));
+        }
+        writer.put(static_cast<uint32_t>(timetable->trips.size()));
+        for (const TimetableTrip& trip : timetable->trips) {
+            writer.put(static_cast<int32_t>(trip.routeId));
+            writer.put(static_cast<int32_t>(trip.serviceIndex));
+            writer.putArray(trip.stopIds);
+            writer.putArray(trip.arrivalTimes);
+            writer.putArray(trip.departureTimes);
+        }
+    }
+
+    GraphSnapshotHeader header;
+    std::memcpy(header.magic, GRAPH_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = FORMAT_VERSION;
+    header.sourceHash = sourceHash;
+    header.graphFingerprint = graph.getFingerprint();
+    header.payloadSize = blob.size() - sizeof(GraphSnapshotHeader);
+    header.payloadChecksum = hashBytes(blob.data() + sizeof(GraphSnapshotHeader), header.payloadSize);
+    header.hasTimetable = timetable ? 1 : 0;
+    header.reserved = 0;
+    std::memcpy(blob.data(), &header, sizeof(header));
+    return blob;
+}
+
+bool GraphSnapshot::writeToFile(const std::vector<uint8_t>& blob, const std::string& path) {
+    std::string tempPath = path + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = fwrite(blob.data(), 1, blob.size(), file) == blob.size();
+    written = fclose(file) == 0 && written;
+    if (!written || rename(tempPath.c_str(), path.c_str()) != 0) {
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool GraphSnapshot::load(const uint8_t* data, size_t size, uint64_t sourceHash, MetroGraph& graph,
+                         Timetable* timetable) {
+    graph.clear();
+    if (timetable) {
+        timetable->clear();
+    }
+    if (size < sizeof(GraphSnapshotHeader)) {
+        return false;
+    }
+
+    GraphSnapshotHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const uint8_t* payload = data + sizeof(GraphSnapshotHeader);
+    if (std::memcmp(header.magic, GRAPH_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != FORMAT_VERSION ||
+        header.sourceHash != sourceHash ||
+        header.payloadSize != size - sizeof(GraphSnapshotHeader) ||
+        (timetable && !header.hasTimetable) ||
+        hashBytes(payload, header.payloadSize) != header.payloadChecksum) {
+        return false;
+    }
+
+    SnapshotReader reader(payload, header.payloadSize);
+    uint32_t stationCount = reader.get<uint32_t>();
+    if (stationCount > header.payloadSize) {
+        return false;
+    }
+    std::vector<int> stationIds(stationCount);
+    for (size_t i = 0; i < stationIds.size() && reader.ok; i++) {
+        stationIds[i] = reader.get<int32_t>();
+        std::string code = reader.getString();
+        std::string name = reader.getString();
+        double latitude = reader.get<double>();
+        double longitude = reader.get<double>();
+        graph.addStation(MetroStation(stationIds[i], std::move(code), std::move(name), latitude, longitude));
+    }
+
+    uint32_t lineCount = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < lineCount && reader.ok; i++) {
+        int id = reader.get<int32_t>();
+        std::string name = reader.getString();
+        std::string color = reader.getString();
+        graph.addLine(MetroLine(id, std::move(name), std::move(color)));
+    }
+
+    for (size_t i = 0; i < stationIds.size() && reader.ok; i++) {
+        uint32_t edgeCount = reader.get<uint32_t>();
+        for (uint32_t e = 0; e < edgeCount && reader.ok; e++) {
+            int targetId = reader.get<int32_t>();
+            int lineId = reader.get<int32_t>();
+            double distance = reader.get<double>();
+            double time = reader.get<double>();
+            EdgeTiming timing = reader.get<EdgeTiming>();
+            graph.addEdge(MetroEdge(stationIds[i], targetId, lineId, distance, time, timing));
+        }
+    }
+
+    if (header.hasTimetable) {
+        uint32_t serviceCount = reader.get<uint32_t>();
+        for (uint32_t i = 0; i < serviceCount && reader.ok; i++) {
+            std::string id = reader.getString();
+            uint8_t weekdays = reader.get<uint8_t>();
+            int startDate = reader.get<int32_t>();
+            int endDate = reader.get<int32_t>();
+            if (timetable) {
+                timetable->services.emplace_back(std::move(id), weekdays, startDate, endDate);
+            }
+        }
+        uint32_t tripCount = reader.get<uint32_t>();
+        TimetableTrip trip;
+        for (uint32_t i = 0; i < tripCount && reader.ok; i++) {
+            trip.routeId = reader.get<int32_t>();
+            trip.serviceIndex = reader.get<int32_t>();
+            reader.getArray(trip.stopIds);
+            reader.getArray(trip.arrivalTimes);
+            reader.getArray(trip.departureTimes);
+            if (timetable) {
+                timetable->trips.push_back(trip);
+            }
+        }
+    }
+
+    // Freezing the replayed edges must reproduce the saved layout exactly
+    if (reader.ok && reader.atEnd()) {
+        graph.freeze();
+        if (graph.getFingerprint() == header.graphFingerprint) {
+            return true;
+        }
+    }
+    graph.clear();
+    if (timetable) {
+        timetable->clear();
+    }
+    return false;
+}
+
+bool GraphSnapshot::loadFromFile(const std::string& path, uint64_t sourceHash, MetroGraph& graph,
+                                 Timetable* timetable) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    size_t size = static_cast<size_t>(fileStat.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    bool loaded = load(static_cast<const uint8_t*>(data), size, sourceHash, graph, timetable);
+    munmap(data, size);
+    return loaded;
+}
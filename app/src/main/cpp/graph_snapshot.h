@@ -0,0 +1,50 @@
+#ifndef GRAPH_SNAPSHOT_H
+#define GRAPH_SNAPSHOT_H
+
+#include "metro_graph.h"
+#include "timetable.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Header of a serialized graph snapshot. The blob is native-endian: header, then a
+// payload of stations, lines, each station's edges with their run times in CSR order
+// and optionally the timetable, with strings stored as a uint32_t length and their bytes.
+struct GraphSnapshotHeader {
+    char magic[4];              // "MGSN"
+    uint32_t version;
+    uint64_t sourceHash;        // Hash of the GTFS files and parser settings it was built from
+    uint64_t graphFingerprint;  // MetroGraph::getFingerprint() of the saved graph
+    uint64_t payloadSize;
+    uint64_t payloadChecksum;   // hashBytes of the payload
+    uint32_t hasTimetable;
+    uint32_t reserved;
+};
+
+// Saves a parsed, frozen MetroGraph (and timetable) so later starts can rebuild it
+// without reading the GTFS text. Loading replays the stations, lines and edges into
+// the graph and freezes it, which gives the same layout and fingerprint as the parse.
+class GraphSnapshot {
+public:
+    static const uint32_t FORMAT_VERSION = 5;
+
+    // 64-bit FNV-1a over 8-byte words (then the remaining bytes), continuing from hash
+    static uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL);
+
+    // Serialize a frozen graph, and the timetable if given; empty if the graph isn't frozen
+    static std::vector<uint8_t> build(const MetroGraph& graph, const Timetable* timetable, uint64_t sourceHash);
+
+    // Write a blob atomically (temporary file, then rename)
+    static bool writeToFile(const std::vector<uint8_t>& blob, const std::string& path);
+
+    // Rebuild the graph, and the timetable if given, from a blob; false if it is
+    // malformed, of another version, built from other sources or lacks a wanted
+    // timetable, in which case the graph and timetable are left cleared
+    static bool load(const uint8_t* data, size_t size, uint64_t sourceHash, MetroGraph& graph, Timetable* timetable);
+
+    // Same from a file, mapped read-only for the duration of the load
+    static bool loadFromFile(const std::string& path, uint64_t sourceHash, MetroGraph& graph, Timetable* timetable);
+};
+
+#endif // GRAPH_SNAPSHOT_H
@@ -0,0 +1,257 @@
+#include "gtfs_csv_reader.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+// Drop leading and trailing spaces and tabs
+static std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+GtfsCsvReader::GtfsCsvReader(std::string_view buffer) : data(buffer) {
+    readHeader();
+}
+
+GtfsCsvReader::GtfsCsvReader(Source fileSource, size_t chunkSize)
+    : source(std::move(fileSource)), window(chunkSize > 0 ? chunkSize : DEFAULT_CHUNK_SIZE, '\0'),
+      exhausted(false) {
+    // Enough bytes to tell whether there is a byte order mark
+    while (!exhausted && data.size() < 3) {
+        refill(0);
+    }
+    readHeader();
+}
+
+GtfsCsvReader::GtfsCsvReader(std::string_view records, const GtfsCsvReader& headerReader)
+    : data(records), header(headerReader.header) {}
+
+void GtfsCsvReader::readHeader() {
+    // Files saved by spreadsheet tools often start with a UTF-8 byte order mark
+    if (data.substr(0, 3) == "\xEF\xBB\xBF") {
+        position = 3;
+    }
+    if (next()) {
+        for (std::string_view name : fields) {
+            header.emplace_back(trim(name));
+        }
+    }
+    fields.clear();
+}
+
+int GtfsCsvReader::getColumn(std::string_view name) const {
+    for (size_t i = 0; i < header.size(); i++) {
+        if (header[i] == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void GtfsCsvReader::refill(size_t keepFrom) {
+    size_t kept = data.size() - keepFrom;
+    std::memmove(&window[0], window.data() + keepFrom, kept);
+    // A record longer than the window needs a bigger one
+    if (kept == window.size()) {
+        window.resize(window.size() * 2);
+    }
+    size_t readBytes = source(&window[kept], window.size() - kept);
+    exhausted = readBytes == 0;
+    data = std::string_view(window.data(), kept + readBytes);
+    position -= keepFrom;
+}
+
+bool GtfsCsvReader::readRecord() {
+    size_t recordStart = position;
+    while (true) {
+        spans.clear();
+        unescaped.clear();
+        position = recordStart;
+        if (position < data.size()) {
+            if (scanRecord()) {
+                return true;
+            }
+        } else if (exhausted) {
+            return false;
+        }
+        // The record runs into the next chunk: keep its start, read more and scan it again
+        refill(recordStart);
+        recordStart = 0;
+    }
+}
+
+bool GtfsCsvReader::scanRecord() {
+    return scanRecord(data, position, exhausted, this);
+}
+
+bool GtfsCsvReader::scanRecord(std::string_view data, size_t& position, bool atEnd, GtfsCsvReader* reader) {
+    size_t size = data.size();
+    while (true) {
+        FieldSpan span{position, 0, false};
+        if (position < size && data[position] == '"') {
+            // Quoted: runs to the next quote that isn't doubled
+            size_t start = ++position;
+            size_t copied = start;
+            while (position < size) {
+                if (data[position] != '"') {
+                    position++;
+                } else if (position + 1 < size && data[position + 1] == '"') {
+                    if (reader) {
+                        if (!span.escaped) {
+                            span = FieldSpan{reader->unescaped.size(), 0, true};
+                        }
+                        reader->unescaped.append(data.data() + copied, position + 1 - copied);
+                    }
+                    position += 2;
+                    copied = position;
+                } else {
+                    break;
+                }
+            }
+            if (span.escaped) {
+                reader->unescaped.append(data.data() + copied, position - copied);
+                span.length = reader->unescaped.size() - span.offset;
+            } else {
+                span = FieldSpan{start, position - start, false};
+            }
+            // Skip the closing quote and anything stray before the delimiter
+            while (position < size && data[position] != ',' && data[position] != '\n' && data[position] != '\r') {
+                position++;
+            }
+        } else {
+            while (position < size && data[position] != ',' && data[position] != '\n' && data[position] != '\r') {
+                position++;
+            }
+            span.length = position - span.offset;
+        }
+
+        // Without a delimiter, or with a \r that may be half of \r\n, the record is only
+        // complete at the end of the file
+        if (!atEnd && (position >= size || (data[position] == '\r' && position + 1 >= size))) {
+            return false;
+        }
+        if (reader) {
+            reader->spans.push_back(span);
+        }
+
+        if (position < size && data[position] == ',') {
+            position++;
+            continue;
+        }
+        // End of the record: \n, \r\n or \r
+        if (position < size && data[position] == '\r') {
+            position++;
+        }
+        if (position < size && data[position] == '\n') {
+            position++;
+        }
+        return true;
+    }
+}
+
+bool GtfsCsvReader::next() {
+    while (readRecord()) {
+        // A blank line reads as a single empty field
+        if (spans.size() == 1 && spans[0].length == 0 && !spans[0].escaped) {
+            continue;
+        }
+        // Views into unescaped are only taken once the record is complete, as appending
+        // may have moved it
+        fields.clear();
+        for (const FieldSpan& span : spans) {
+            fields.push_back(span.escaped ? std::string_view(unescaped).substr(span.offset, span.length)
+                                          : data.substr(span.offset, span.length));
+        }
+        return true;
+    }
+    fields.clear();
+    return false;
+}
+
+bool GtfsCsvReader::parseInt(std::string_view text, int& value) {
+    text = trim(text);
+    if (!text.empty() && text.front() == '+') {
+        text.remove_prefix(1);
+    }
+    if (text.empty()) {
+        return false;
+    }
+    const char* last = text.data() + text.size();
+    auto result = std::from_chars(text.data(), last, value);
+    return result.ec == std::errc() && result.ptr == last;
+}
+
+bool GtfsCsvReader::parseDouble(std::string_view text, double& value) {
+    // Floating-point from_chars is missing from the NDK's libc++, so the field is
+    // copied to a terminated buffer for strtod; coordinates are far shorter than this
+    text = trim(text);
+    char buffer[64];
+    if (text.empty() || text.size() >= sizeof(buffer)) {
+        return false;
+    }
+    std::memcpy(buffer, text.data(), text.size());
+    buffer[text.size()] = '\0';
+    char* end = nullptr;
+    value = std::strtod(buffer, &end);
+    return end == buffer + text.size();
+}
+
+size_t GtfsCsvReader::skipLineBreak(std::string_view data, size_t lineBreak) {
+    if (data[lineBreak] == '\n') {
+        return lineBreak + 1;
+    }
+    if (lineBreak + 1 >= data.size()) {
+        return std::string_view::npos;
+    }
+    return data[lineBreak + 1] == '\n' ? lineBreak + 2 : lineBreak + 1;
+}
+
+size_t GtfsCsvReader::findRecordEnd(std::string_view data, size_t from, size_t start) {
+    // Records only end at line breaks, and without quotes before it the first one ends
+    // a record; the scan is only needed when quotes might hide it
+    from = std::max(from, start);
+    size_t lineBreak = data.find_first_of("\r\n", from);
+    if (lineBreak == std::string_view::npos) {
+        return std::string_view::npos;
+    }
+    size_t end = skipLineBreak(data, lineBreak);
+    if (end == std::string_view::npos || !std::memchr(data.data() + start, '"', end - start)) {
+        return end;
+    }
+    size_t position = start;
+    while (position <= from) {
+        if (!scanRecord(data, position, false, nullptr)) {
+            return std::string_view::npos;
+        }
+    }
+    return position;
+}
+
+size_t GtfsCsvReader::findLastRecordEnd(std::string_view data, size_t start) {
+    // The last line break ends the last record when no quote comes before it (a \r
+    // ending data doesn't count, see skipLineBreak)
+    size_t lineBreak = data.find_last_of("\r\n");
+    size_t end = lineBreak == std::string_view::npos ? lineBreak : skipLineBreak(data, lineBreak);
+    if (end == std::string_view::npos && lineBreak != std::string_view::npos && lineBreak > 0) {
+        lineBreak = data.find_last_of("\r\n", lineBreak - 1);
+        end = lineBreak == std::string_view::npos ? lineBreak : skipLineBreak(data, lineBreak);
+    }
+    if (end == std::string_view::npos || end <= start) {
+        return start;
+    }
+    if (!std::memchr(data.data() + start, '"', end - start)) {
+        return end;
+    }
+    size_t position = start;
+    size_t last = start;
+    while (scanRecord(data, position, false, nullptr)) {
+        last = position;
+    }
+    return last;
+}
@@ -0,0 +1,102 @@
+#ifndef GTFS_CSV_READER_H
+#define GTFS_CSV_READER_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Record-by-record reader over a GTFS CSV file, either held in memory or streamed in
+// chunks. Fields are views into the buffer, so rows are split without copying; the
+// buffer must outlive the reader. Quoted fields may hold commas, line breaks and
+// doubled quotes, and only fields with doubled quotes are copied (to undo the
+// escaping). Columns are found by header name.
+class GtfsCsvReader {
+public:
+    // Copies up to capacity bytes of a file into buffer and returns how many; 0 at its end
+    using Source = std::function<size_t(char* buffer, size_t capacity)>;
+
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+private:
+    // Where a field of the current record lives: in data, or in unescaped
+    struct FieldSpan {
+        size_t offset;
+        size_t length;
+        bool escaped;
+    };
+
+    std::string_view data;
+    size_t position = 0;
+    std::vector<std::string> header;
+    std::vector<FieldSpan> spans;
+    std::vector<std::string_view> fields;
+    std::string unescaped;      // quoted fields of the current record with "" undone
+
+    // Streaming only: the chunk being read, led by the unread part of the previous one
+    Source source;
+    std::string window;
+    bool exhausted = true;
+
+    // Take the column names from the first record
+    void readHeader();
+
+    // Move data from keepFrom on to the front of the window and read more after it
+    void refill(size_t keepFrom);
+
+    // Split the record at position into spans; false at the end of the file
+    bool readRecord();
+
+    // Scan one record from position; false if it runs past the bytes read so far
+    bool scanRecord();
+
+    // Scan the record at position in data and move position past it; false if it runs
+    // past the end of data while more may follow (atEnd false). Its fields go to
+    // reader's spans, or nowhere when only looking for where records end
+    static bool scanRecord(std::string_view data, size_t& position, bool atEnd, GtfsCsvReader* reader);
+
+    // Offset just past the line break at lineBreak (\n, \r\n or \r), or npos for a \r
+    // ending data
+    static size_t skipLineBreak(std::string_view data, size_t lineBreak);
+
+public:
+    // Start reading a buffer, taking the column names from its first record
+    explicit GtfsCsvReader(std::string_view buffer);
+
+    // Start reading a file from source, chunkSize bytes at a time. Only the current chunk
+    // (and a record split between chunks) is held, so field views last until next()
+    explicit GtfsCsvReader(Source fileSource, size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+    // Read records that follow a header read by another reader, e.g. one shard of a file
+    GtfsCsvReader(std::string_view records, const GtfsCsvReader& headerReader);
+
+    // Index of a header column, or -1 if the file doesn't have it
+    int getColumn(std::string_view name) const;
+
+    // Advance to the next record, skipping blank lines; false once the buffer is done
+    bool next();
+
+    // Field of the current record, empty if the column is -1 or the row is short
+    std::string_view getField(int column) const {
+        return column >= 0 && static_cast<size_t>(column) < fields.size() ? fields[column] : std::string_view();
+    }
+
+    // Parse a field of the current record; false if it is missing or not a number
+    bool getInt(int column, int& value) const { return parseInt(getField(column), value); }
+    bool getDouble(int column, double& value) const { return parseDouble(getField(column), value); }
+
+    // Whole-field number parsing; surrounding spaces are allowed, anything else fails
+    static bool parseInt(std::string_view text, int& value);
+    static bool parseDouble(std::string_view text, double& value);
+
+    // Offset just past the first record of data ending after from, or npos if none does.
+    // Records are followed from start, a record boundary at or before from, by the same
+    // rules next() reads them with: only a quote opening a field starts a quoted field.
+    // A \r ending data may be half of \r\n, so it ends no record
+    static size_t findRecordEnd(std::string_view data, size_t from, size_t start = 0);
+
+    // Offset just past the last record of data ending after start, or start if none does
+    static size_t findLastRecordEnd(std::string_view data, size_t start = 0);
+};
+
+#endif // GTFS_CSV_READER_H
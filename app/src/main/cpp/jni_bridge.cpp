@@ -2,26 +2,58 @@
 #include <android/log.h>
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <limits>
 #include <string>
 
 #define LOG_TAG "MetroNative"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 
-// Helper function to get the line color name (part before the space)
-static std::string getLineColorName(const std::string& lineName);
-
-// Helper function to check if two lines represent a real interchange
-bool isRealInterchange(std::unique_ptr<MetroGraph>& graph, int prevLineId, int currentLineId);
-
 // Global instances
 std::unique_ptr<MetroGraph> gMetroGraph;
 std::unique_ptr<MetroPathFinder> gPathFinder;
+std::unique_ptr<Timetable> gTimetable;
+std::unique_ptr<RaptorRouter> gRaptorRouter;
+std::unique_ptr<ConnectionScanRouter> gConnectionScanRouter;
+std::unique_ptr<ParetoRouter> gParetoRouter;
+std::unique_ptr<KShortestPathFinder> gKShortestPathFinder;
+
+// Search algorithm selected from Kotlin, kept across re-initialization
+static SearchAlgorithm gSearchAlgorithm = SearchAlgorithm::Dijkstra;
+
+// Timetable engine selected from Kotlin
+static TimetableEngine gTimetableEngine = TimetableEngine::Raptor;
+
+// Footpath settings handed to the parser on the next initialization; none until
+// setFootpathsNative asks for them
+static double gFootpathRadiusKm = 0;
+static double gWalkingSpeedKmPerMinute = MetroDataParser::DEFAULT_WALKING_SPEED_KM_PER_MINUTE;
+static double gFootpathPenaltyMinutes = MetroDataParser::DEFAULT_FOOTPATH_PENALTY_MINUTES;
+
+// Printable name of a search algorithm for logs
+static const char* searchAlgorithmName(SearchAlgorithm algorithm) {
+    switch (algorithm) {
+        case SearchAlgorithm::AStar: return "A*";
+        case SearchAlgorithm::Bidirectional: return "bidirectional";
+        case SearchAlgorithm::ContractionHierarchy: return "contraction hierarchy";
+        case SearchAlgorithm::RouteTable: return "route table";
+        default: return "Dijkstra";
+    }
+}
+
+// Log how much of the network the last query on this thread had to settle
+static void logSearchStats(const char* query) {
+    const SearchStats& stats = MetroPathFinder::getLastSearchStats();
+    LOGI("%s (%s): settled %d nodes, relaxed %d edges, %d queue pushes, %d pops", query,
+         searchAlgorithmName(gSearchAlgorithm), stats.settledNodes, stats.relaxedEdges,
+         stats.heapPushes, stats.heapPops);
+}
 
 extern "C" {
 
 JNIEXPORT jboolean JNICALL
-Java_com_example_opendelhitransit_data_native_MetroNativeLib_initMetroGraphNative(JNIEnv* env, jobject thiz, jobject assetManager) {
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_initMetroGraphNative(JNIEnv* env, jobject thiz, jobject assetManager, jstring snapshotPath) {
     // Get the AAssetManager
     AAssetManager* nativeAssetManager = AAssetManager_fromJava(env, assetManager);
     if (!nativeAssetManager) {
@@ -34,15 +66,46 @@ Java_com_example_opendelhitransit_data_native_MetroNativeLib_initMetroGraphNativ
         gMetroGraph = std::make_unique<MetroGraph>();
     }
     
-    // Create Metro Data Parser
+    // Create Metro Data Parser, keeping the scheduled trips for the timetable router
+    if (!gTimetable) {
+        gTimetable = std::make_unique<Timetable>();
+    }
+    gRaptorRouter.reset();
+    gConnectionScanRouter.reset();
     MetroDataParser parser(*gMetroGraph, nativeAssetManager);
-    
-    // Parse GTFS data
-    bool success = parser.parseGTFSData();
+    parser.setTimetable(gTimetable.get());
+    parser.setFootpaths(gFootpathRadiusKm, gWalkingSpeedKmPerMinute, gFootpathPenaltyMinutes);
+    
+    // Load the snapshot saved by an earlier start when the assets haven't changed,
+    // otherwise parse the GTFS data (and save a snapshot if a path was given)
+    auto startTime = std::chrono::steady_clock::now();
+    bool success;
+    if (snapshotPath) {
+        const char* snapshotPathChars = env->GetStringUTFChars(snapshotPath, nullptr);
+        std::string snapshotPathStr(snapshotPathChars);
+        env->ReleaseStringUTFChars(snapshotPath, snapshotPathChars);
+        success = parser.loadGTFSData(snapshotPathStr);
+    } else {
+        success = parser.parseGTFSData();
+    }
+    LOGI("Metro graph ready in %.1f ms",
+         std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
     
     if (success) {
         // Create path finder
         gPathFinder = std::make_unique<MetroPathFinder>(*gMetroGraph);
+        gPathFinder->setSearchAlgorithm(gSearchAlgorithm);
+        
+        // Preprocess once so contraction hierarchy queries can be selected at any time
+        gPathFinder->buildContractionHierarchies();
+        gParetoRouter = std::make_unique<ParetoRouter>(*gMetroGraph);
+        gKShortestPathFinder = std::make_unique<KShortestPathFinder>(*gMetroGraph);
+        
+        // Group the scheduled trips into routes for earliest-arrival queries
+        gRaptorRouter = std::make_unique<RaptorRouter>(*gTimetable, *gMetroGraph);
+        LOGI("Timetable router: %d routes, %d trips", gRaptorRouter->getRouteCount(), gRaptorRouter->getTripCount());
+        gConnectionScanRouter = std::make_unique<ConnectionScanRouter>(*gTimetable, *gMetroGraph);
+        LOGI("Connection scan: %d connections", gConnectionScanRouter->getConnectionCount());
         LOGI("Metro graph initialized successfully");
     } else {
         LOGE("Failed to initialize metro graph");
@@ -60,6 +123,7 @@ Java_com_example_opendelhitransit_data_native_MetroNativeLib_findShortestPathNat
     
     // Find shortest path
     MetroPath path = gPathFinder->findShortestPath(sourceId, targetId);
+    logSearchStats("Shortest path");
     
     // Convert to Java object
     return createJavaMetroPath(env, path);
@@ -74,11 +138,132 @@ Java_com_example_opendelhitransit_data_native_MetroNativeLib_findFastestPathNati
     
     // Find fastest path
     MetroPath path = gPathFinder->findFastestPath(sourceId, targetId);
+    logSearchStats("Fastest path");
+    
+    // Convert to Java object
+    return createJavaMetroPath(env, path);
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_findAccessiblePathNative(JNIEnv* env, jobject thiz, jint sourceId, jint targetId, jdouble interchangeMinutes) {
+    if (!gPathFinder) {
+        LOGE("Path finder not initialized");
+        return nullptr;
+    }
+    
+    // Fastest path with interchanges weighted by interchangeMinutes
+    MetroPath path = gPathFinder->findPathWithCost(sourceId, targetId, AccessibleTimeCost(interchangeMinutes));
+    logSearchStats("Accessible path");
     
     // Convert to Java object
     return createJavaMetroPath(env, path);
 }
 
+JNIEXPORT jobject JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_findTravelTimesNative(JNIEnv* env, jobject thiz, jint sourceId, jdouble maxMinutes) {
+    if (!gPathFinder) {
+        LOGE("Path finder not initialized");
+        return nullptr;
+    }
+    
+    // One search from the source, stopping at the time budget
+    StationTimes times = gPathFinder->findFastestTimes(sourceId, maxMinutes);
+    logSearchStats("Travel times");
+    
+    // Convert to Java object
+    return createJavaStationTravelTimes(env, times);
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_computeMatrixNative(JNIEnv* env, jobject thiz, jintArray sources, jintArray targets, jint mode) {
+    if (!gPathFinder) {
+        LOGE("Path finder not initialized");
+        return nullptr;
+    }
+    if (mode != 0 && mode != 1) {
+        LOGE("Unknown matrix mode %d", mode);
+        return nullptr;
+    }
+    
+    // Copy the station IDs out once
+    std::vector<int> sourceIds(env->GetArrayLength(sources));
+    std::vector<int> targetIds(env->GetArrayLength(targets));
+    env->GetIntArrayRegion(sources, 0, static_cast<jsize>(sourceIds.size()), sourceIds.data());
+    env->GetIntArrayRegion(targets, 0, static_cast<jsize>(targetIds.size()), targetIds.data());
+    
+    // The result is one Java array, which can't hold more than a jsize of entries
+    uint64_t entryCount = static_cast<uint64_t>(sourceIds.size()) * targetIds.size();
+    if (entryCount > static_cast<uint64_t>(std::numeric_limits<jsize>::max())) {
+        LOGE("Matrix of %zu x %zu entries is too large", sourceIds.size(), targetIds.size());
+        return nullptr;
+    }
+    
+    // One search per source across the worker threads, into a single buffer
+    std::vector<float> costs(static_cast<size_t>(entryCount));
+    gPathFinder->computeMatrix(sourceIds, targetIds, mode == 0, costs.data());
+    LOGI("Matrix: %zu x %zu %s", sourceIds.size(), targetIds.size(), mode == 0 ? "distances" : "times");
+    
+    // Convert to Java array
+    jfloatArray result = env->NewFloatArray(static_cast<jsize>(costs.size()));
+    if (result) {
+        env->SetFloatArrayRegion(result, 0, static_cast<jsize>(costs.size()), costs.data());
+    }
+    return result;
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_findEarliestArrivalNative(JNIEnv* env, jobject thiz, jint sourceId, jint targetId, jint departureTime, jint dayOfWeek) {
+    if (!gRaptorRouter || !gConnectionScanRouter) {
+        LOGE("Timetable router not initialized");
+        return nullptr;
+    }
+    
+    // Find earliest arrival over the scheduled trips with the selected engine
+    TimetableJourney journey = gTimetableEngine == TimetableEngine::ConnectionScan ?
+        gConnectionScanRouter->findEarliestArrival(sourceId, targetId, departureTime, dayOfWeek) :
+        gRaptorRouter->findEarliestArrival(sourceId, targetId, departureTime, dayOfWeek);
+    LOGI("Earliest arrival (%s): leave %d, arrive %d, %d trains",
+         gTimetableEngine == TimetableEngine::ConnectionScan ? "connection scan" : "RAPTOR",
+         journey.departureTime, journey.arrivalTime, journey.rounds);
+    
+    // Convert to Java object
+    return createJavaMetroPath(env, journey.path);
+}
+
+JNIEXPORT jobjectArray JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_findParetoPathsNative(JNIEnv* env, jobject thiz, jint sourceId, jint targetId) {
+    if (!gParetoRouter) {
+        LOGE("Pareto router not initialized");
+        return nullptr;
+    }
+    
+    // Find every non-dominated trade-off of time, interchanges and distance in one search
+    std::vector<MetroPath> paths = gParetoRouter->findParetoPaths(sourceId, targetId);
+    const SearchStats& stats = ParetoRouter::getLastSearchStats();
+    LOGI("Pareto paths: %zu alternatives, expanded %d labels, relaxed %d edges",
+         paths.size(), stats.settledNodes, stats.relaxedEdges);
+    
+    // Convert to Java array
+    return createJavaMetroPathArray(env, paths);
+}
+
+JNIEXPORT jobjectArray JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_findAlternativePathsNative(JNIEnv* env, jobject thiz, jint sourceId, jint targetId, jint count, jboolean useDistance) {
+    if (!gKShortestPathFinder) {
+        LOGE("Alternative path finder not initialized");
+        return nullptr;
+    }
+    
+    // Find up to count loopless paths that don't mostly share line segments
+    std::vector<MetroPath> paths = gKShortestPathFinder->findAlternativePaths(sourceId, targetId, count, useDistance == JNI_TRUE);
+    const SearchStats& stats = KShortestPathFinder::getLastSearchStats();
+    LOGI("Alternative paths: %zu found, settled %d nodes, relaxed %d edges",
+         paths.size(), stats.settledNodes, stats.relaxedEdges);
+    
+    // Convert to Java array
+    return createJavaMetroPathArray(env, paths);
+}
+
 JNIEXPORT jobject JNICALL
 Java_com_example_opendelhitransit_data_native_MetroNativeLib_findShortestPathByNamesNative(JNIEnv* env, jobject thiz, jstring sourceName, jstring targetName) {
     if (!gPathFinder) {
@@ -106,6 +291,7 @@ Java_com_example_opendelhitransit_data_native_MetroNativeLib_findShortestPathByN
         LOGE("No path found between '%s' and '%s'", sourceNameStr.c_str(), targetNameStr.c_str());
         return nullptr;
     }
+    logSearchStats("Shortest path");
     
     // Convert to Java object
     return createJavaMetroPath(env, path);
@@ -138,6 +324,7 @@ Java_com_example_opendelhitransit_data_native_MetroNativeLib_findFastestPathByNa
         LOGE("No path found between '%s' and '%s'", sourceNameStr.c_str(), targetNameStr.c_str());
         return nullptr;
     }
+    logSearchStats("Fastest path");
     
     // Convert to Java object
     return createJavaMetroPath(env, path);
@@ -171,11 +358,170 @@ Java_com_example_opendelhitransit_data_native_MetroNativeLib_getAllStationNamesN
     return result;
 }
 
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setSearchAlgorithmNative(JNIEnv* env, jobject thiz, jint algorithm) {
+    if (algorithm < static_cast<jint>(SearchAlgorithm::Dijkstra) ||
+        algorithm > static_cast<jint>(SearchAlgorithm::RouteTable)) {
+        LOGE("Unknown search algorithm %d", algorithm);
+        return JNI_FALSE;
+    }
+    
+    gSearchAlgorithm = static_cast<SearchAlgorithm>(algorithm);
+    if (gPathFinder) {
+        gPathFinder->setSearchAlgorithm(gSearchAlgorithm);
+    }
+    return JNI_TRUE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setTimetableEngineNative(JNIEnv* env, jobject thiz, jint engine) {
+    if (engine < static_cast<jint>(TimetableEngine::Raptor) ||
+        engine > static_cast<jint>(TimetableEngine::ConnectionScan)) {
+        LOGE("Unknown timetable engine %d", engine);
+        return JNI_FALSE;
+    }
+    
+    gTimetableEngine = static_cast<TimetableEngine>(engine);
+    return JNI_TRUE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setFootpathsNative(JNIEnv* env, jobject thiz, jdouble radiusKm, jdouble walkingSpeedKmh, jdouble penaltyMinutes) {
+    if (!(radiusKm >= 0) || !(walkingSpeedKmh > 0) || !(penaltyMinutes >= 0)) {
+        LOGE("Invalid footpath settings %.2f km, %.2f km/h, %.2f min", radiusKm, walkingSpeedKmh, penaltyMinutes);
+        return JNI_FALSE;
+    }
+    
+    gFootpathRadiusKm = radiusKm;
+    gWalkingSpeedKmPerMinute = walkingSpeedKmh / 60.0;
+    gFootpathPenaltyMinutes = penaltyMinutes;
+    return JNI_TRUE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setStationClosedNative(JNIEnv* env, jobject thiz, jint stationId, jboolean closed) {
+    if (!gPathFinder) {
+        LOGE("Path finder not initialized");
+        return JNI_FALSE;
+    }
+    return gPathFinder->getOverlay().setStationClosed(stationId, closed == JNI_TRUE) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setLineClosedNative(JNIEnv* env, jobject thiz, jint lineId, jboolean closed) {
+    if (!gPathFinder) {
+        LOGE("Path finder not initialized");
+        return JNI_FALSE;
+    }
+    return gPathFinder->getOverlay().setLineClosed(lineId, closed == JNI_TRUE) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setSegmentClosedNative(JNIEnv* env, jobject thiz, jint stationIdA, jint stationIdB, jboolean closed) {
+    if (!gPathFinder) {
+        LOGE("Path finder not initialized");
+        return JNI_FALSE;
+    }
+    return gPathFinder->getOverlay().setSegmentClosed(stationIdA, stationIdB, closed == JNI_TRUE) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setLineTimeScaleNative(JNIEnv* env, jobject thiz, jint lineId, jdouble factor) {
+    if (!gPathFinder) {
+        LOGE("Path finder not initialized");
+        return JNI_FALSE;
+    }
+    return gPathFinder->getOverlay().setLineTimeScale(lineId, factor) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setSegmentTimeScaleNative(JNIEnv* env, jobject thiz, jint stationIdA, jint stationIdB, jdouble factor) {
+    if (!gPathFinder) {
+        LOGE("Path finder not initialized");
+        return JNI_FALSE;
+    }
+    return gPathFinder->getOverlay().setSegmentTimeScale(stationIdA, stationIdB, factor) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_clearDisruptionsNative(JNIEnv* env, jobject thiz) {
+    if (gPathFinder) {
+        gPathFinder->getOverlay().clear();
+    }
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_loadRouteTableNative(JNIEnv* env, jobject thiz, jobject assetManager, jstring cachePath) {
+    if (!gPathFinder) {
+        LOGE("Path finder not initialized");
+        return JNI_FALSE;
+    }
+    
+    const char* cachePathChars = env->GetStringUTFChars(cachePath, nullptr);
+    std::string cachePathStr(cachePathChars);
+    env->ReleaseStringUTFChars(cachePath, cachePathChars);
+    
+    std::unique_ptr<RouteTable> table = std::make_unique<RouteTable>();
+    
+    // A table cached by an earlier run is mapped as is; stale ones fail the fingerprint check
+    if (table->loadFromFile(cachePathStr, *gMetroGraph)) {
+        LOGI("Mapped route table from %s", cachePathStr.c_str());
+        gPathFinder->setRouteTable(std::move(table));
+        return JNI_TRUE;
+    }
+    
+    // Then a table shipped in the assets (copied, since assets may be compressed)
+    AAssetManager* nativeAssetManager = AAssetManager_fromJava(env, assetManager);
+    AAsset* asset = nativeAssetManager ?
+        AAssetManager_open(nativeAssetManager, "DMRC_GTFS/route_table.bin", AASSET_MODE_BUFFER) : nullptr;
+    if (asset) {
+        const uint8_t* buffer = static_cast<const uint8_t*>(AAsset_getBuffer(asset));
+        size_t length = static_cast<size_t>(AAsset_getLength(asset));
+        bool loaded = buffer && table->loadFromBuffer(std::vector<uint8_t>(buffer, buffer + length), *gMetroGraph);
+        AAsset_close(asset);
+        if (loaded) {
+            LOGI("Loaded route table from assets");
+            gPathFinder->setRouteTable(std::move(table));
+            return JNI_TRUE;
+        }
+    }
+    
+    // Otherwise compute it and cache it for the next start
+    std::vector<uint8_t> blob;
+    try {
+        blob = RouteTable::build(*gMetroGraph);
+    } catch (const std::exception& e) {
+        LOGE("Exception building route table: %s", e.what());
+        return JNI_FALSE;
+    }
+    if (blob.empty()) {
+        LOGE("Failed to build route table");
+        return JNI_FALSE;
+    }
+    LOGI("Built route table (%zu bytes)", blob.size());
+    
+    bool loaded = RouteTable::writeToFile(blob, cachePathStr) ?
+        table->loadFromFile(cachePathStr, *gMetroGraph) : false;
+    if (!loaded) {
+        LOGE("Failed to cache route table at %s", cachePathStr.c_str());
+        loaded = table->loadFromBuffer(std::move(blob), *gMetroGraph);
+    }
+    if (loaded) {
+        gPathFinder->setRouteTable(std::move(table));
+    }
+    return loaded ? JNI_TRUE : JNI_FALSE;
+}
+
 JNIEXPORT jboolean JNICALL
 Java_com_example_opendelhitransit_data_native_MetroNativeLib_releaseResources(JNIEnv* env, jobject thiz) {
     LOGI("Releasing native resources");
     
     try {
+        gRaptorRouter.reset();
+        gConnectionScanRouter.reset();
+        gParetoRouter.reset();
+        gKShortestPathFinder.reset();
+        gTimetable.reset();
         gMetroGraph.reset();
         gPathFinder.reset();
         
@@ -197,7 +543,7 @@ jobject createJavaMetroPath(JNIEnv* env, const MetroPath& path) {
     }
     
     // Find constructor
-    jmethodID constructor = env->GetMethodID(metroPathClass, "<init>", "(Ljava/util/List;Ljava/util/List;Ljava/util/List;DDI)V");
+    jmethodID constructor = env->GetMethodID(metroPathClass, "<init>", "(Ljava/util/List;Ljava/util/List;Ljava/util/List;DDIII)V");
     if (!constructor) {
         LOGE("Failed to find MetroPath constructor");
         return nullptr;
@@ -257,8 +603,14 @@ jobject createJavaMetroPath(JNIEnv* env, const MetroPath& path) {
         for (size_t i = 1; i < path.lineIds.size(); i++) {
             int currentLineId = path.lineIds[i];
             
+            // A walk between two lines puts the interchange where the next ride starts
+            if (currentLineId == MetroGraph::WALKING_LINE_ID) {
+                continue;
+            }
+            
             // If line changes, add the corresponding station as an interchange
-            if (isRealInterchange(gMetroGraph, prevLineId, currentLineId)) {
+            // (same precomputed colour-family table the path finder uses)
+            if (prevLineId != MetroGraph::WALKING_LINE_ID && gMetroGraph->isInterchange(prevLineId, currentLineId)) {
                 int stationId = path.stationIds[i];
                 
                 // Get station name for the interchange
@@ -282,11 +634,14 @@ jobject createJavaMetroPath(JNIEnv* env, const MetroPath& path) {
         }
     }
     
-    // Create the MetroPath object with the lists and data
+    // Create the MetroPath object with the lists and data; the end stop_ids tell which
+    // station was chosen when a name matched several
+    jint sourceStationId = path.stationIds.empty() ? -1 : path.stationIds.front();
+    jint targetStationId = path.stationIds.empty() ? -1 : path.stationIds.back();
     jobject result = env->NewObject(metroPathClass, constructor, 
                                    stationsList, linesList, interchangesList, 
                                    path.totalDistance, path.totalTime, 
-                                   path.interchangeCount);
+                                   path.interchangeCount, sourceStationId, targetStationId);
     
     // Clean up local references
     env->DeleteLocalRef(stationsList);
@@ -296,42 +651,58 @@ jobject createJavaMetroPath(JNIEnv* env, const MetroPath& path) {
     return result;
 }
 
-} // extern "C" 
-
-// Helper function to get the line color name (part before the space)
-static std::string getLineColorName(const std::string& lineName) {
-    // Find the first space
-    size_t spacePos = lineName.find(' ');
-    if (spacePos != std::string::npos) {
-        // Return part before space, converted to lowercase
-        std::string colorName = lineName.substr(0, spacePos);
-        std::transform(colorName.begin(), colorName.end(), colorName.begin(),
-                      [](unsigned char c){ return std::tolower(c); });
-        return colorName;
-    }
-    return lineName; // Return the whole name if no space found
-}
-
-// Helper function to check if two lines represent a real interchange
-bool isRealInterchange(std::unique_ptr<MetroGraph>& graph, int prevLineId, int currentLineId) {
-    // If they have the same ID, they're definitely the same line
-    if (prevLineId == currentLineId) {
-        return false;
+// Helper function to convert StationTimes to a Java StationTravelTimes object of packed arrays
+jobject createJavaStationTravelTimes(JNIEnv* env, const StationTimes& times) {
+    jclass travelTimesClass = env->FindClass("com/example/opendelhitransit/data/model/StationTravelTimes");
+    if (!travelTimesClass) {
+        LOGE("Failed to find StationTravelTimes class");
+        return nullptr;
+    }
+    
+    jmethodID constructor = env->GetMethodID(travelTimesClass, "<init>", "([I[F[F)V");
+    if (!constructor) {
+        LOGE("Failed to find StationTravelTimes constructor");
+        return nullptr;
     }
     
-    // Get the line objects
-    const MetroLine* prevLine = graph->getLine(prevLineId);
-    const MetroLine* currentLine = graph->getLine(currentLineId);
+    jsize count = static_cast<jsize>(times.stationIds.size());
+    std::vector<jfloat> minutes(times.times.begin(), times.times.end());
+    std::vector<jfloat> kilometres(times.distances.begin(), times.distances.end());
+    jintArray stationIds = env->NewIntArray(count);
+    jfloatArray timeArray = env->NewFloatArray(count);
+    jfloatArray distanceArray = env->NewFloatArray(count);
+    env->SetIntArrayRegion(stationIds, 0, count, times.stationIds.data());
+    env->SetFloatArrayRegion(timeArray, 0, count, minutes.data());
+    env->SetFloatArrayRegion(distanceArray, 0, count, kilometres.data());
+    
+    jobject result = env->NewObject(travelTimesClass, constructor, stationIds, timeArray, distanceArray);
     
-    // If either line doesn't exist, consider it an interchange
-    if (!prevLine || !currentLine) {
-        return true;
+    // Clean up local references
+    env->DeleteLocalRef(stationIds);
+    env->DeleteLocalRef(timeArray);
+    env->DeleteLocalRef(distanceArray);
+    env->DeleteLocalRef(travelTimesClass);
+    
+    return result;
+}
+
+// Helper function to convert a list of MetroPaths to a Java MetroPath array
+jobjectArray createJavaMetroPathArray(JNIEnv* env, const std::vector<MetroPath>& paths) {
+    jclass metroPathClass = env->FindClass("com/example/opendelhitransit/data/model/MetroPath");
+    if (!metroPathClass) {
+        LOGE("Failed to find MetroPath class");
+        return nullptr;
     }
     
-    // Get color parts of the names (e.g., "magenta" from "Magenta Line")
-    std::string prevColor = getLineColorName(prevLine->name);
-    std::string currentColor = getLineColorName(currentLine->name);
+    jobjectArray result = env->NewObjectArray(paths.size(), metroPathClass, nullptr);
+    for (size_t i = 0; i < paths.size(); i++) {
+        jobject path = createJavaMetroPath(env, paths[i]);
+        env->SetObjectArrayElement(result, i, path);
+        env->DeleteLocalRef(path);
+    }
     
-    // It's a real interchange only if the color parts are different
-    return prevColor != currentColor;
-} 
\ No newline at end of file
+    env->DeleteLocalRef(metroPathClass);
+    return result;
+}
+
+} // extern "C" 
@@ -13,17 +13,26 @@
 #include "metro_graph.h"
 #include "metro_path_finder.h"
 #include "metro_data_parser.h"
+#include "raptor_router.h"
+#include "connection_scan.h"
+#include "pareto_router.h"
+#include "k_shortest_paths.h"
 
 // Global pointers to access from different JNI functions
 extern std::unique_ptr<MetroGraph> gMetroGraph;
 extern std::unique_ptr<MetroPathFinder> gPathFinder;
+extern std::unique_ptr<Timetable> gTimetable;
+extern std::unique_ptr<RaptorRouter> gRaptorRouter;
+extern std::unique_ptr<ConnectionScanRouter> gConnectionScanRouter;
+extern std::unique_ptr<ParetoRouter> gParetoRouter;
+extern std::unique_ptr<KShortestPathFinder> gKShortestPathFinder;
 
 // JNI function declarations
 extern "C" {
 
-// Initialize the metro graph with data from GTFS files
+// Initialize the metro graph with data from GTFS files, through a snapshot file at snapshotPath if not null
 JNIEXPORT jboolean JNICALL
-Java_com_example_opendelhitransit_data_native_MetroNativeLib_initMetroGraphNative(JNIEnv* env, jobject thiz, jobject assetManager);
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_initMetroGraphNative(JNIEnv* env, jobject thiz, jobject assetManager, jstring snapshotPath);
 
 // Find shortest path between two stations by station IDs
 JNIEXPORT jobject JNICALL
@@ -33,6 +42,30 @@ Java_com_example_opendelhitransit_data_native_MetroNativeLib_findShortestPathNat
 JNIEXPORT jobject JNICALL
 Java_com_example_opendelhitransit_data_native_MetroNativeLib_findFastestPathNative(JNIEnv* env, jobject thiz, jint sourceId, jint targetId);
 
+// Find fastest path between two stations by station IDs, weighting each interchange as interchangeMinutes
+JNIEXPORT jobject JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_findAccessiblePathNative(JNIEnv* env, jobject thiz, jint sourceId, jint targetId, jdouble interchangeMinutes);
+
+// Find fastest times and distances from one station to every station reachable within maxMinutes
+JNIEXPORT jobject JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_findTravelTimesNative(JNIEnv* env, jobject thiz, jint sourceId, jdouble maxMinutes);
+
+// Compute distances (mode 0) or times (mode 1) from every source to every target, row-major
+JNIEXPORT jfloatArray JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_computeMatrixNative(JNIEnv* env, jobject thiz, jintArray sources, jintArray targets, jint mode);
+
+// Find the earliest arrival by scheduled trains, leaving at departureTime (seconds after midnight) on dayOfWeek (0 = Monday)
+JNIEXPORT jobject JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_findEarliestArrivalNative(JNIEnv* env, jobject thiz, jint sourceId, jint targetId, jint departureTime, jint dayOfWeek);
+
+// Find all non-dominated paths over (time, interchanges, distance) between two stations by station IDs
+JNIEXPORT jobjectArray JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_findParetoPathsNative(JNIEnv* env, jobject thiz, jint sourceId, jint targetId);
+
+// Find up to count dissimilar loopless paths between two stations by station IDs, cheapest first
+JNIEXPORT jobjectArray JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_findAlternativePathsNative(JNIEnv* env, jobject thiz, jint sourceId, jint targetId, jint count, jboolean useDistance);
+
 // Find shortest path between two stations by names
 JNIEXPORT jobject JNICALL
 Java_com_example_opendelhitransit_data_native_MetroNativeLib_findShortestPathByNamesNative(JNIEnv* env, jobject thiz, jstring sourceName, jstring targetName);
@@ -41,6 +74,46 @@ Java_com_example_opendelhitransit_data_native_MetroNativeLib_findShortestPathByN
 JNIEXPORT jobject JNICALL
 Java_com_example_opendelhitransit_data_native_MetroNativeLib_findFastestPathByNamesNative(JNIEnv* env, jobject thiz, jstring sourceName, jstring targetName);
 
+// Select the point-to-point search algorithm (0 = Dijkstra, 1 = A*, 2 = bidirectional,
+// 3 = contraction hierarchy, 4 = route table)
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setSearchAlgorithmNative(JNIEnv* env, jobject thiz, jint algorithm);
+
+// Select the engine for earliest-arrival queries (0 = RAPTOR, 1 = connection scan)
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setTimetableEngineNative(JNIEnv* env, jobject thiz, jint engine);
+
+// Link stations within radiusKm by walking edges at walkingSpeedKmh plus penaltyMinutes
+// (radius 0 disables them); applies from the next initMetroGraphNative
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setFootpathsNative(JNIEnv* env, jobject thiz, jdouble radiusKm, jdouble walkingSpeedKmh, jdouble penaltyMinutes);
+
+// Close or reopen a station, a line, or the segment between two stations (both directions)
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setStationClosedNative(JNIEnv* env, jobject thiz, jint stationId, jboolean closed);
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setLineClosedNative(JNIEnv* env, jobject thiz, jint lineId, jboolean closed);
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setSegmentClosedNative(JNIEnv* env, jobject thiz, jint stationIdA, jint stationIdB, jboolean closed);
+
+// Multiply ride times of a line, or between two stations (both directions); 1 restores the schedule
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setLineTimeScaleNative(JNIEnv* env, jobject thiz, jint lineId, jdouble factor);
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_setSegmentTimeScaleNative(JNIEnv* env, jobject thiz, jint stationIdA, jint stationIdB, jdouble factor);
+
+// Reopen everything and restore all ride times
+JNIEXPORT void JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_clearDisruptionsNative(JNIEnv* env, jobject thiz);
+
+// Load the all-pairs route table: mmap the cache file, else the copy in assets,
+// else build it and write the cache file
+JNIEXPORT jboolean JNICALL
+Java_com_example_opendelhitransit_data_native_MetroNativeLib_loadRouteTableNative(JNIEnv* env, jobject thiz, jobject assetManager, jstring cachePath);
+
 // Get all station names
 JNIEXPORT jobjectArray JNICALL
 Java_com_example_opendelhitransit_data_native_MetroNativeLib_getAllStationNamesNative(JNIEnv* env, jobject thiz);
@@ -48,6 +121,12 @@ Java_com_example_opendelhitransit_data_native_MetroNativeLib_getAllStationNamesN
 // Helper function to convert a C++ MetroPath to a Java MetroPath object
 jobject createJavaMetroPath(JNIEnv* env, const MetroPath& path);
 
+// Helper function to convert StationTimes to a Java StationTravelTimes object
+jobject createJavaStationTravelTimes(JNIEnv* env, const StationTimes& times);
+
+// Helper function to convert C++ MetroPaths to a Java MetroPath array
+jobjectArray createJavaMetroPathArray(JNIEnv* env, const std::vector<MetroPath>& paths);
+
 } // extern "C"
 
 #endif // JNI_BRIDGE_H 
\ No newline at end of file
@@ -0,0 +1,292 @@
+#include "k_shortest_paths.h"
+#include "cost_policy.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+KShortestPathFinder::Workspace& KShortestPathFinder::threadWorkspace() {
+    thread_local Workspace workspace;
+    return workspace;
+}
+
+double KShortestPathFinder::findSpurPath(Workspace& workspace, int spurStation, int spurLine, int targetIndex,
+                                         bool useDistance, Candidate& path) const {
+    const double infinity = std::numeric_limits<double>::infinity();
+    QueryWorkspace& search = workspace.search;
+    const QueryWorkspace& tree = workspace.tree;
+    search.begin(static_cast<size_t>(graph.getStateCount()));
+    std::vector<DijkstraNode>& heap = search.heap;
+    std::greater<> heapCompare;
+
+    // Remaining cost can't be below the backward tree's, which ignores interchanges;
+    // scaled down slightly so rounding keeps it consistent
+    auto lowerBound = [&](int station) { return (1.0 - 1e-9) * tree.getDist(station); };
+    auto isBlocked = [&](int station) { return workspace.blockedStamp[station] == workspace.blockedGeneration; };
+
+    // Relax the edges of a station reached on a line into states (-1 = leaving the spur station)
+    auto relax = [&](int station, int line, double cost, int fromState) {
+        for (const CsrEdge& edge : graph.getEdges(station)) {
+            workspace.stats.relaxedEdges++;
+            if (isBlocked(edge.targetIndex) || tree.getDist(edge.targetIndex) == infinity) {
+                continue;
+            }
+            if (fromState < 0) {
+                bool blockedHop = false;
+                for (const std::pair<int, int>& hop : workspace.blockedHops) {
+                    blockedHop = blockedHop || (hop.first == edge.targetIndex && hop.second == edge.lineIndex);
+                }
+                if (blockedHop) {
+                    continue;
+                }
+            }
+
+            double newCost = cost + (useDistance ? edge.distance : edge.time);
+            if (!useDistance && line >= 0 && graph.isInterchangeAt(line, edge.lineIndex)) {
+                newCost += INTERCHANGE_PENALTY_MINUTES;
+            }
+            int state = graph.getEdgeTargetState(graph.getEdgeIndex(edge));
+            if (search.getDist(state) > newCost) {
+                search.setDist(state, newCost, fromState, edge.lineIndex);
+                heap.push_back(DijkstraNode(state, newCost + lowerBound(edge.targetIndex), fromState, edge.lineIndex));
+                std::push_heap(heap.begin(), heap.end(), heapCompare);
+                workspace.stats.heapPushes++;
+            }
+        }
+    };
+
+    relax(spurStation, spurLine, 0, -1);
+    int targetState = -1;
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), heapCompare);
+        int state = heap.back().stationId;
+        heap.pop_back();
+        workspace.stats.heapPops++;
+        if (search.isSettled(state)) {
+            continue;
+        }
+        search.markSettled(state);
+        workspace.stats.settledNodes++;
+
+        int station = graph.getStateStation(state);
+        if (station == targetIndex) {
+            targetState = state;
+            break;
+        }
+        relax(station, graph.getStateLine(state), search.getDist(state), state);
+    }
+    if (targetState < 0) {
+        return infinity;
+    }
+
+    // Append the spur's hops, walking the states back to the spur station
+    size_t first = path.stations.size();
+    double rootCost = path.prefixCost.back();
+    for (int state = targetState; state >= 0; state = search.getPrevNode(state)) {
+        path.stations.push_back(graph.getStateStation(state));
+        path.lines.push_back(graph.getStateLine(state));
+        path.prefixCost.push_back(rootCost + search.getDist(state));
+    }
+    std::reverse(path.stations.begin() + first, path.stations.end());
+    std::reverse(path.lines.begin() + (first - 1), path.lines.end());
+    std::reverse(path.prefixCost.begin() + first, path.prefixCost.end());
+    return search.getDist(targetState);
+}
+
+double KShortestPathFinder::similarity(const Candidate& a, const Candidate& b) {
+    size_t shared = 0;
+    for (size_t i = 0; i < a.lines.size(); i++) {
+        for (size_t j = 0; j < b.lines.size(); j++) {
+            if (a.stations[i] == b.stations[j] && a.stations[i + 1] == b.stations[j + 1] &&
+                a.lines[i] == b.lines[j]) {
+                shared++;
+                break;
+            }
+        }
+    }
+    size_t hops = std::min(a.lines.size(), b.lines.size());
+    return hops > 0 ? static_cast<double>(shared) / hops : 1.0;
+}
+
+MetroPath KShortestPathFinder::toMetroPath(const Candidate& candidate, bool useDistance) const {
+    MetroPath path;
+    path.interchangeCount = graph.countInterchangesAt(candidate.lines);
+    int chargedInterchanges = 0;
+    for (size_t i = 1; i < candidate.lines.size(); i++) {
+        if (graph.isInterchangeAt(candidate.lines[i - 1], candidate.lines[i])) {
+            chargedInterchanges++;
+        }
+    }
+
+    // Sum the metric we didn't optimize for from the first matching edge of each hop
+    double otherTotal = 0;
+    for (size_t i = 0; i < candidate.lines.size(); i++) {
+        for (const CsrEdge& edge : graph.getEdges(candidate.stations[i])) {
+            if (edge.targetIndex == candidate.stations[i + 1] && edge.lineIndex == candidate.lines[i]) {
+                otherTotal += useDistance ? edge.time : edge.distance;
+                break;
+            }
+        }
+    }
+    if (useDistance) {
+        path.totalDistance = candidate.cost;
+        path.totalTime = otherTotal + chargedInterchanges * INTERCHANGE_PENALTY_MINUTES;
+    } else {
+        path.totalTime = candidate.cost;
+        path.totalDistance = otherTotal;
+    }
+
+    for (int station : candidate.stations) {
+        path.stationIds.push_back(graph.getStationIdAt(station));
+    }
+    for (int line : candidate.lines) {
+        path.lineIds.push_back(graph.getLineIdAt(line));
+    }
+    return path;
+}
+
+std::vector<MetroPath> KShortestPathFinder::findAlternativePaths(int sourceId, int targetId, int k, bool useDistance,
+                                                                 double maxSimilarity) const {
+    std::vector<MetroPath> paths;
+    if (!graph.isFrozen() || k < 1) {
+        return paths;
+    }
+
+    int sourceIndex = graph.getStationIndex(sourceId);
+    int targetIndex = graph.getStationIndex(targetId);
+    if (sourceIndex < 0 || targetIndex < 0) {
+        return paths;
+    }
+    if (sourceIndex == targetIndex) {
+        MetroPath path;
+        path.stationIds.push_back(sourceId);
+        paths.push_back(path);
+        return paths;
+    }
+
+    Workspace& workspace = threadWorkspace();
+    workspace.stats = SearchStats();
+    int stationCount = graph.getStationCount();
+    if (workspace.blockedStamp.size() != static_cast<size_t>(stationCount)) {
+        workspace.blockedStamp.assign(stationCount, 0);
+        workspace.blockedGeneration = 0;
+    }
+
+    // Backward tree from the target over stations, without interchange penalties:
+    // a lower bound on the remaining cost that every spur search shares
+    QueryWorkspace& tree = workspace.tree;
+    tree.begin(static_cast<size_t>(stationCount));
+    std::greater<> heapCompare;
+    tree.setDist(targetIndex, 0, -1, -1);
+    tree.heap.push_back(DijkstraNode(targetIndex, 0, -1, -1));
+    while (!tree.heap.empty()) {
+        std::pop_heap(tree.heap.begin(), tree.heap.end(), heapCompare);
+        DijkstraNode current = tree.heap.back();
+        tree.heap.pop_back();
+        if (tree.isSettled(current.stationId)) {
+            continue;
+        }
+        tree.markSettled(current.stationId);
+        for (const ReverseCsrEdge& edge : graph.getStationReverseEdges(current.stationId)) {
+            double newDist = current.cost + (useDistance ? edge.distance : edge.time);
+            if (tree.getDist(edge.sourceIndex) > newDist) {
+                tree.setDist(edge.sourceIndex, newDist, current.stationId, -1);
+                tree.heap.push_back(DijkstraNode(edge.sourceIndex, newDist, current.stationId, -1));
+                std::push_heap(tree.heap.begin(), tree.heap.end(), heapCompare);
+            }
+        }
+    }
+
+    auto blockStations = [&](const Candidate& root, size_t count) {
+        if (++workspace.blockedGeneration == 0) {
+            std::fill(workspace.blockedStamp.begin(), workspace.blockedStamp.end(), 0);
+            workspace.blockedGeneration = 1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            workspace.blockedStamp[root.stations[i]] = workspace.blockedGeneration;
+        }
+    };
+
+    // Shortest path first
+    Candidate shortest;
+    shortest.stations.push_back(sourceIndex);
+    shortest.prefixCost.push_back(0);
+    blockStations(shortest, 1);
+    workspace.blockedHops.clear();
+    shortest.cost = findSpurPath(workspace, sourceIndex, -1, targetIndex, useDistance, shortest);
+    if (shortest.cost == std::numeric_limits<double>::infinity()) {
+        return paths;
+    }
+
+    std::vector<Candidate> enumerated(1, shortest);
+    std::vector<Candidate> pending;
+    std::vector<size_t> returned(1, 0);
+    int enumerationLimit = k * ENUMERATION_FACTOR;
+
+    while (static_cast<int>(returned.size()) < k && static_cast<int>(enumerated.size()) < enumerationLimit) {
+        // Deviate from the last path at each station from where it left its parent on;
+        // spurs from earlier stations share the parent's root and were already found
+        const Candidate last = enumerated.back();
+        for (size_t i = last.deviation; i + 1 < last.stations.size(); i++) {
+            // Hops already taken out of this root by enumerated paths
+            workspace.blockedHops.clear();
+            for (const Candidate& other : enumerated) {
+                if (other.stations.size() > i + 1 &&
+                    std::equal(last.stations.begin(), last.stations.begin() + i + 1, other.stations.begin()) &&
+                    std::equal(last.lines.begin(), last.lines.begin() + i, other.lines.begin())) {
+                    workspace.blockedHops.emplace_back(other.stations[i + 1], other.lines[i]);
+                }
+            }
+            blockStations(last, i + 1);
+
+            Candidate candidate;
+            candidate.stations.assign(last.stations.begin(), last.stations.begin() + i + 1);
+            candidate.lines.assign(last.lines.begin(), last.lines.begin() + i);
+            candidate.prefixCost.assign(last.prefixCost.begin(), last.prefixCost.begin() + i + 1);
+            double spurCost = findSpurPath(workspace, last.stations[i], i > 0 ? last.lines[i - 1] : -1,
+                                           targetIndex, useDistance, candidate);
+            if (spurCost == std::numeric_limits<double>::infinity()) {
+                continue;
+            }
+            candidate.cost = candidate.prefixCost.back();
+            candidate.deviation = i;
+
+            // The spur avoids the root but may pass one of its own stations twice on different lines
+            std::vector<int> visited(candidate.stations.begin() + i, candidate.stations.end());
+            std::sort(visited.begin(), visited.end());
+            if (std::adjacent_find(visited.begin(), visited.end()) != visited.end()) {
+                continue;
+            }
+
+            bool known = false;
+            for (const Candidate& other : pending) {
+                known = known || (other.stations == candidate.stations && other.lines == candidate.lines);
+            }
+            if (!known) {
+                pending.push_back(std::move(candidate));
+            }
+        }
+        if (pending.empty()) {
+            break;
+        }
+
+        // Next cheapest path; keep it if it differs enough from those returned
+        auto next = std::min_element(pending.begin(), pending.end(), [](const Candidate& a, const Candidate& b) {
+            return a.cost < b.cost;
+        });
+        enumerated.push_back(std::move(*next));
+        pending.erase(next);
+
+        bool distinct = true;
+        for (size_t index : returned) {
+            distinct = distinct && similarity(enumerated.back(), enumerated[index]) <= maxSimilarity;
+        }
+        if (distinct) {
+            returned.push_back(enumerated.size() - 1);
+        }
+    }
+
+    for (size_t index : returned) {
+        paths.push_back(toMetroPath(enumerated[index], useDistance));
+    }
+    return paths;
+}
@@ -0,0 +1,72 @@
+#ifndef K_SHORTEST_PATHS_H
+#define K_SHORTEST_PATHS_H
+
+#include "metro_graph.h"
+#include "query_workspace.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Alternative routes by Yen's k-shortest loopless paths over the line-aware states.
+// One backward tree from the target, computed once per query, is the A* lower bound
+// for every spur search, so spurs mostly run straight down the tree. Paths are
+// enumerated in cost order and only those sharing few line segments with the routes
+// already returned are kept.
+class KShortestPathFinder {
+private:
+    // An enumerated path: dense stations and lines, and the cost to reach each station
+    struct Candidate {
+        std::vector<int> stations;
+        std::vector<int> lines;
+        std::vector<double> prefixCost;
+        double cost = 0;
+        size_t deviation = 0;   // Station where it left the path it was spurred from
+    };
+
+    // Scratch space reused across queries on a thread
+    struct Workspace {
+        QueryWorkspace search;              // Spur searches, over states
+        QueryWorkspace tree;                // Backward lower bounds, over stations
+        std::vector<uint32_t> blockedStamp; // Stations of the current root path
+        uint32_t blockedGeneration = 0;
+        std::vector<std::pair<int, int>> blockedHops;  // (next station, line) out of the spur station
+        SearchStats stats;
+    };
+
+    const MetroGraph& graph;
+
+    static Workspace& threadWorkspace();
+
+    // Cheapest path from spurStation, reached on spurLine (-1 at the source), to the
+    // target avoiding blocked stations and hops; appended to path. Returns its cost,
+    // or infinity.
+    double findSpurPath(Workspace& workspace, int spurStation, int spurLine, int targetIndex,
+                        bool useDistance, Candidate& path) const;
+
+    // Share of the shorter path's hops ridden on the same line by both paths
+    static double similarity(const Candidate& a, const Candidate& b);
+
+    // Totals and public IDs of an enumerated path
+    MetroPath toMetroPath(const Candidate& candidate, bool useDistance) const;
+
+public:
+    static const int DEFAULT_PATH_COUNT = 3;
+    static constexpr double DEFAULT_MAX_SIMILARITY = 0.7;
+
+    // Paths enumerated per requested path before giving up on finding dissimilar ones
+    static const int ENUMERATION_FACTOR = 10;
+
+    explicit KShortestPathFinder(const MetroGraph& metroGraph) : graph(metroGraph) {}
+
+    // Up to k loopless paths from sourceId to targetId, cheapest first by distance or
+    // by time (with INTERCHANGE_PENALTY_MINUTES per interchange). A path is skipped if
+    // more than maxSimilarity of its line segments are shared with a path already
+    // returned.
+    std::vector<MetroPath> findAlternativePaths(int sourceId, int targetId, int k, bool useDistance,
+                                                double maxSimilarity = DEFAULT_MAX_SIMILARITY) const;
+
+    // Counters summed over the spur searches of the last query on the calling thread
+    static const SearchStats& getLastSearchStats() { return threadWorkspace().stats; }
+};
+
+#endif // K_SHORTEST_PATHS_H
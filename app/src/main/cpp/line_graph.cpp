@@ -0,0 +1,71 @@
+#include "line_graph.h"
+#include <algorithm>
+
+LineGraph::LineGraph(const MetroGraph& graph) {
+    nodeOffsets.assign(1, 0);
+    rideOffsets.assign(1, 0);
+    transferOffsets.assign(1, 0);
+    if (!graph.isFrozen()) {
+        return;
+    }
+
+    // A station gets one node per line arriving at or leaving it, ordered by line index
+    int stationCount = graph.getStationCount();
+    std::vector<int> stationLines;
+    for (int station = 0; station < stationCount; station++) {
+        stationLines.clear();
+        for (const CsrEdge& edge : graph.getEdges(station)) {
+            stationLines.push_back(edge.lineIndex);
+        }
+        for (int state = graph.getFirstState(station); state < graph.getEndState(station); state++) {
+            stationLines.push_back(graph.getStateLine(state));
+        }
+        std::sort(stationLines.begin(), stationLines.end());
+        stationLines.erase(std::unique(stationLines.begin(), stationLines.end()), stationLines.end());
+
+        for (int lineIndex : stationLines) {
+            nodeStation.push_back(station);
+            nodeLine.push_back(lineIndex);
+        }
+        nodeOffsets.push_back(static_cast<int>(nodeStation.size()));
+    }
+
+    auto findNode = [&](int station, int lineIndex) {
+        auto first = nodeLine.begin() + nodeOffsets[station];
+        auto last = nodeLine.begin() + nodeOffsets[station + 1];
+        return static_cast<int>(std::lower_bound(first, last, lineIndex) - nodeLine.begin());
+    };
+
+    // Rides: the fastest edge to each neighbour on every line the node's line changes
+    // to without an interchange (its own, the rest of its family, walking), arriving at
+    // the neighbour's node of the line ridden. bestRide holds the position in rides of
+    // the ride to a node, valid while rideStamp matches.
+    int nodeCount = getNodeCount();
+    std::vector<int> rideStamp(nodeCount, -1);
+    std::vector<int> bestRide(nodeCount, -1);
+    for (int node = 0; node < nodeCount; node++) {
+        int station = nodeStation[node];
+        int lineIndex = nodeLine[node];
+        for (const CsrEdge& edge : graph.getEdges(station)) {
+            if (edge.targetIndex == station || graph.isInterchangeAt(lineIndex, edge.lineIndex)) {
+                continue;
+            }
+            int target = findNode(edge.targetIndex, edge.lineIndex);
+            if (rideStamp[target] != node) {
+                rideStamp[target] = node;
+                bestRide[target] = static_cast<int>(rides.size());
+                rides.push_back(CsrEdge{target, edge.lineIndex, edge.distance, edge.time});
+            } else if (edge.time < rides[bestRide[target]].time) {
+                rides[bestRide[target]] = CsrEdge{target, edge.lineIndex, edge.distance, edge.time};
+            }
+        }
+        rideOffsets.push_back(static_cast<int>(rides.size()));
+
+        for (int other = nodeOffsets[station]; other < nodeOffsets[station + 1]; other++) {
+            if (other != node && graph.isInterchangeAt(lineIndex, nodeLine[other])) {
+                transfers.push_back(other);
+            }
+        }
+        transferOffsets.push_back(static_cast<int>(transfers.size()));
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef LINE_GRAPH_H
+#define LINE_GRAPH_H
+
+#include "metro_graph.h"
+#include <vector>
+
+// Line-expanded copy of a frozen MetroGraph: one node per (station, line) the line
+// serves, ride edges between the nodes of lines changed without an interchange and
+// explicit transfer edges between the nodes of one station. Real interchanges are
+// the transfer edges, so a search pays for them by following an edge instead of
+// checking lines per hop, and keeps separate labels for arrivals on different lines.
+class LineGraph {
+private:
+    std::vector<int> nodeOffsets;       // size = station count + 1
+    std::vector<int> nodeStation;
+    std::vector<int> nodeLine;
+
+    // Rides leaving each node, targetIndex holding the node ridden to. A node rides
+    // every line it can change to for free, rather than through zero-weight changes at
+    // the station: walking changes freely to and from any line, so chaining such
+    // changes would skip real interchanges.
+    std::vector<int> rideOffsets;       // size = node count + 1
+    std::vector<CsrEdge> rides;
+
+    // Nodes of the same station reached by a real interchange
+    std::vector<int> transferOffsets;   // size = node count + 1
+    std::vector<int> transfers;
+
+public:
+    // Build from a frozen graph (empty otherwise). Parallel edges of one line collapse
+    // into the fastest, the first in adjacency order on ties.
+    explicit LineGraph(const MetroGraph& graph);
+
+    int getNodeCount() const { return static_cast<int>(nodeStation.size()); }
+    int getRideCount() const { return static_cast<int>(rides.size()); }
+    int getTransferCount() const { return static_cast<int>(transfers.size()); }
+
+    // First node of a dense station index and one past its last
+    int getFirstNode(int index) const { return nodeOffsets[index]; }
+    int getEndNode(int index) const { return nodeOffsets[index + 1]; }
+
+    // Station and dense line index of a node
+    int getNodeStation(int node) const { return nodeStation[node]; }
+    int getNodeLine(int node) const { return nodeLine[node]; }
+
+    CsrRange<CsrEdge> getRides(int node) const {
+        const CsrEdge* base = rides.data();
+        return CsrRange<CsrEdge>{base + rideOffsets[node], base + rideOffsets[node + 1]};
+    }
+
+    CsrRange<int> getTransfers(int node) const {
+        const int* base = transfers.data();
+        return CsrRange<int>{base + transferOffsets[node], base + transferOffsets[node + 1]};
+    }
+};
+
+#endif // LINE_GRAPH_H
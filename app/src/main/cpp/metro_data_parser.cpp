@@ -1,25 +1,102 @@
 #include "metro_data_parser.h"
+#include "station_grid.h"
+#include "gtfs_csv_reader.h"
+#include "graph_snapshot.h"
+#include "task_pool.h"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <unordered_set>
 #include <android/log.h>
 
 #define LOG_TAG "MetroDataParser"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 
+// Asset opened for reading front to back in chunks, without loading it whole
+class AssetStream {
+private:
+    AAsset* asset;
+
+public:
+    AssetStream(AAssetManager* assetManager, const std::string& filename) {
+        if (!assetManager) {
+            throw std::runtime_error("Asset manager is null");
+        }
+        asset = AAssetManager_open(assetManager, filename.c_str(), AASSET_MODE_STREAMING);
+        if (!asset) {
+            throw std::runtime_error("Failed to open asset: " + filename);
+        }
+    }
+    
+    ~AssetStream() { AAsset_close(asset); }
+    
+    AssetStream(const AssetStream&) = delete;
+    AssetStream& operator=(const AssetStream&) = delete;
+    
+    uint64_t getLength() const { return static_cast<uint64_t>(AAsset_getLength(asset)); }
+    
+    // Fill buffer with the next bytes of the asset; fewer than capacity only at its end
+    size_t read(char* buffer, size_t capacity) {
+        size_t filled = 0;
+        while (filled < capacity) {
+            int readBytes = AAsset_read(asset, buffer + filled, capacity - filled);
+            if (readBytes < 0) {
+                throw std::runtime_error("Failed to read asset");
+            }
+            if (readBytes == 0) {
+                break;
+            }
+            filled += static_cast<size_t>(readBytes);
+        }
+        return filled;
+    }
+};
+
 // Parse all GTFS data
 bool MetroDataParser::parseGTFSData() {
     try {
         // Clear any existing data
         graph.clear();
+        if (timetable) {
+            timetable->clear();
+        }
         
-        // Parse stops first (stations)
-        parseStops();
+        // Tokenize the small files side by side: stops (stations), routes (metro lines),
+        // and trips after the service calendars they refer to when timed trips are wanted
+        std::vector<MetroStation> stations;
+        std::vector<MetroLine> lines;
+        std::vector<TimetableService> services;
+        std::unordered_map<std::string, TripInfo> trips;
+        TaskPool::shared().run({
+            [&] { stations = readStops(); },
+            [&] { lines = readRoutes(); },
+            [&] {
+                if (timetable) {
+                    services = readCalendar();
+                }
+                trips = readTrips(services);
+            }
+        }, parseThreads);
         
-        // Parse routes (metro lines)
-        parseRoutes();
+        // Then fill the graph in file order, as reading the files one by one would
+        for (const MetroStation& station : stations) {
+            graph.addStation(station);
+        }
+        for (const MetroLine& line : lines) {
+            graph.addLine(line);
+        }
+        if (timetable) {
+            timetable->services = std::move(services);
+        }
         
-        // Parse trips, stop_times, etc. to build connections
-        parseTripData();
+        // Parse stop_times to build connections
+        parseTripData(trips);
         
         // Verification: check if any connections were created
         bool hasConnections = false;
@@ -36,6 +113,14 @@ bool MetroDataParser::parseGTFSData() {
             createFallbackConnections();
         }
         
+        // Let searches walk between stations close to each other
+        addFootpaths();
+        
+        // Pack the adjacency into the dense CSR layout used by all queries
+        graph.freeze();
+        LOGI("Froze metro graph: %d stations, %d edges",
+             graph.getStationCount(), static_cast<int>(graph.getEdgeCount()));
+        
         return true;
     } catch (const std::exception& e) {
         LOGE("Error parsing GTFS data: %s", e.what());
@@ -43,155 +128,253 @@ bool MetroDataParser::parseGTFSData() {
     }
 }
 
+// Hash every GTFS file the parse reads, with the settings that shape the graph
+uint64_t MetroDataParser::computeSourceHash() {
+    static const char* const files[] = {
+        "DMRC_GTFS/stops.txt", "DMRC_GTFS/routes.txt", "DMRC_GTFS/trips.txt",
+        "DMRC_GTFS/stop_times.txt", "DMRC_GTFS/calendar.txt"
+    };
+    
+    // Whole chunks are a multiple of 8 bytes, so hashing them one after another gives
+    // the hash of the whole file
+    uint64_t hash = GraphSnapshot::hashBytes(nullptr, 0);
+    std::vector<char> chunk(GtfsCsvReader::DEFAULT_CHUNK_SIZE);
+    for (const char* file : files) {
+        AssetStream stream(assetManager, file);
+        uint64_t length = stream.getLength();
+        hash = GraphSnapshot::hashBytes(&length, sizeof(length), hash);
+        size_t readBytes;
+        while ((readBytes = stream.read(chunk.data(), chunk.size())) > 0) {
+            hash = GraphSnapshot::hashBytes(chunk.data(), readBytes, hash);
+        }
+    }
+    
+    // The graph also depends on the footpath settings and whether trips are kept
+    double settings[] = {footpathRadiusKm, walkingSpeedKmPerMinute, footpathPenaltyMinutes, timetable ? 1.0 : 0.0};
+    return GraphSnapshot::hashBytes(settings, sizeof(settings), hash);
+}
+
+// Load from a snapshot when it matches the assets, else parse and save one
+bool MetroDataParser::loadGTFSData(const std::string& snapshotPath) {
+    uint64_t sourceHash;
+    try {
+        sourceHash = computeSourceHash();
+    } catch (const std::exception& e) {
+        LOGE("Error reading GTFS data: %s", e.what());
+        return false;
+    }
+    
+    if (GraphSnapshot::loadFromFile(snapshotPath, sourceHash, graph, timetable)) {
+        LOGI("Loaded metro graph snapshot: %d stations, %d edges",
+             graph.getStationCount(), static_cast<int>(graph.getEdgeCount()));
+        return true;
+    }
+    
+    if (!parseGTFSData()) {
+        return false;
+    }
+    if (!GraphSnapshot::writeToFile(GraphSnapshot::build(graph, timetable, sourceHash), snapshotPath)) {
+        LOGE("Failed to write graph snapshot to %s", snapshotPath.c_str());
+    }
+    return true;
+}
+
 // Parse stops.txt to get station information
-void MetroDataParser::parseStops() {
+std::vector<MetroStation> MetroDataParser::readStops() {
     LOGI("Parsing stops.txt");
     
     // Read stops.txt from assets
     std::string stopsData = readFileFromAssets("DMRC_GTFS/stops.txt");
     
-    std::istringstream stopsStream(stopsData);
-    std::string line;
-    
-    // Skip header line
-    std::getline(stopsStream, line);
-    
-    // Process each line
-    while (std::getline(stopsStream, line)) {
-        std::istringstream lineStream(line);
-        std::string cell;
-        std::vector<std::string> tokens;
-        
-        // Parse CSV format
-        while (std::getline(lineStream, cell, ',')) {
-            tokens.push_back(cell);
-        }
-        
-        if (tokens.size() >= 5) {
-            int id = std::stoi(tokens[0]);
-            std::string code = tokens[1];
-            std::string name = tokens[2];
-            double lat = std::stod(tokens[4]);
-            double lon = std::stod(tokens[5]);
-            
-            // Add station to graph
-            graph.addStation(MetroStation(id, code, name, lat, lon));
+    GtfsCsvReader reader(stopsData);
+    int idColumn = requireColumn(reader, "stop_id", "stops.txt");
+    int codeColumn = reader.getColumn("stop_code");
+    int nameColumn = reader.getColumn("stop_name");
+    int latColumn = requireColumn(reader, "stop_lat", "stops.txt");
+    int lonColumn = requireColumn(reader, "stop_lon", "stops.txt");
+    
+    // Process each row; rows without a numeric ID or coordinates are skipped
+    std::vector<MetroStation> stations;
+    while (reader.next()) {
+        int id;
+        double lat, lon;
+        if (reader.getInt(idColumn, id) && reader.getDouble(latColumn, lat) && reader.getDouble(lonColumn, lon)) {
+            std::string code(reader.getField(codeColumn));
+            std::string name(reader.getField(nameColumn));
+            stations.emplace_back(id, std::move(code), std::move(name), lat, lon);
         }
     }
+    return stations;
 }
 
 // Parse routes.txt to get metro line information
-void MetroDataParser::parseRoutes() {
+std::vector<MetroLine> MetroDataParser::readRoutes() {
     LOGI("Parsing routes.txt");
     
     // Read routes.txt from assets
     std::string routesData = readFileFromAssets("DMRC_GTFS/routes.txt");
     
-    std::istringstream routesStream(routesData);
-    std::string line;
-    
-    // Skip header line
-    std::getline(routesStream, line);
-    
-    // Process each line
-    while (std::getline(routesStream, line)) {
-        std::istringstream lineStream(line);
-        std::string cell;
-        std::vector<std::string> tokens;
-        
-        // Parse CSV format
-        while (std::getline(lineStream, cell, ',')) {
-            tokens.push_back(cell);
-        }
-        
-        if (tokens.size() >= 4) {
-            int id = std::stoi(tokens[0]);
-            std::string name = tokens[3];
-            std::string color = tokens.size() >= 8 ? tokens[7] : "";
-            
-            // Add line to graph
-            graph.addLine(MetroLine(id, name, color));
+    GtfsCsvReader reader(routesData);
+    int idColumn = requireColumn(reader, "route_id", "routes.txt");
+    int nameColumn = reader.getColumn("route_long_name");
+    int colorColumn = reader.getColumn("route_color");
+    
+    // Process each row
+    std::vector<MetroLine> lines;
+    while (reader.next()) {
+        int id;
+        if (reader.getInt(idColumn, id)) {
+            std::string name(reader.getField(nameColumn));
+            std::string color(reader.getField(colorColumn));
+            lines.emplace_back(id, std::move(name), std::move(color));
         }
     }
+    return lines;
 }
 
-// Parse trips.txt and stop_times.txt to build connections between stations
-void MetroDataParser::parseTripData() {
-    LOGI("Parsing trip data");
-    
-    // Read trips.txt to get route-to-trip mapping
-    std::string tripsData = readFileFromAssets("DMRC_GTFS/trips.txt");
-    
-    std::unordered_map<std::string, int> tripToRoute;
-    
-    std::istringstream tripsStream(tripsData);
-    std::string line;
+// Parse trips.txt to get each trip's route and service
+std::unordered_map<std::string, MetroDataParser::TripInfo> MetroDataParser::readTrips(
+        const std::vector<TimetableService>& services) {
+    LOGI("Parsing trips.txt");
+    
+    // Service IDs of the calendars, to look up each trip's service once
+    std::unordered_map<std::string, int> serviceIndex;
+    for (size_t i = 0; i < services.size(); i++) {
+        serviceIndex.emplace(services[i].id, static_cast<int>(i));
+    }
     
-    // Skip header
-    std::getline(tripsStream, line);
+    AssetStream tripsFile(assetManager, "DMRC_GTFS/trips.txt");
+    GtfsCsvReader reader([&tripsFile](char* buffer, size_t capacity) {
+        return tripsFile.read(buffer, capacity);
+    });
+    int routeColumn = requireColumn(reader, "route_id", "trips.txt");
+    int serviceColumn = requireColumn(reader, "service_id", "trips.txt");
+    int tripColumn = requireColumn(reader, "trip_id", "trips.txt");
     
     // Parse trips
-    while (std::getline(tripsStream, line)) {
-        std::istringstream lineStream(line);
-        std::string cell;
-        std::vector<std::string> tokens;
+    std::unordered_map<std::string, TripInfo> trips;
+    std::string serviceId;
+    while (reader.next()) {
+        int routeId;
+        if (reader.getInt(routeColumn, routeId)) {
+            serviceId.assign(reader.getField(serviceColumn));
+            auto service = serviceIndex.find(serviceId);
+            trips[std::string(reader.getField(tripColumn))] =
+                TripInfo{routeId, service != serviceIndex.end() ? service->second : -1, false};
+        }
+    }
+    return trips;
+}
+
+// Read stop_times.txt in batches, tokenizing each one's shards in parallel
+void MetroDataParser::readStopTimes(const std::function<bool(const StopTimeRow&)>& visit) {
+    unsigned threadCount = parseThreads > 0 ? parseThreads : TaskPool::shared().getWorkerCount() + 1;
+    AssetStream file(assetManager, "DMRC_GTFS/stop_times.txt");
+    
+    // The batch holds whole records plus the start of one cut off at its end, which
+    // is carried into the next batch
+    std::string batch(STOP_TIMES_BATCH_SIZE, '\0');
+    size_t filled = 0;
+    bool exhausted = false;
+    std::optional<GtfsCsvReader> header;
+    int tripColumn = -1, arrivalColumn = -1, departureColumn = -1, stopColumn = -1, sequenceColumn = -1;
+    std::vector<std::vector<StopTimeRow>> shardRows;
+    
+    while (!exhausted) {
+        // A record longer than the batch needs a bigger one
+        if (filled == batch.size()) {
+            batch.resize(batch.size() * 2);
+        }
+        size_t readBytes = file.read(&batch[filled], batch.size() - filled);
+        exhausted = filled + readBytes < batch.size();
+        filled += readBytes;
+        std::string_view data(batch.data(), filled);
         
-        while (std::getline(lineStream, cell, ',')) {
-            tokens.push_back(cell);
+        size_t start = 0;
+        if (!header) {
+            size_t headerEnd = GtfsCsvReader::findRecordEnd(data, 0);
+            if (headerEnd == std::string_view::npos) {
+                if (!exhausted) {
+                    continue;
+                }
+                headerEnd = filled;
+            }
+            header.emplace(data.substr(0, headerEnd));
+            tripColumn = requireColumn(*header, "trip_id", "stop_times.txt");
+            arrivalColumn = requireColumn(*header, "arrival_time", "stop_times.txt");
+            departureColumn = requireColumn(*header, "departure_time", "stop_times.txt");
+            stopColumn = requireColumn(*header, "stop_id", "stop_times.txt");
+            sequenceColumn = requireColumn(*header, "stop_sequence", "stop_times.txt");
+            start = headerEnd;
         }
+        size_t end = exhausted ? filled : GtfsCsvReader::findLastRecordEnd(data, start);
         
-        if (tokens.size() >= 3) {
-            int routeId = std::stoi(tokens[0]);
-            std::string tripId = tokens[2];
-            
-            tripToRoute[tripId] = routeId;
+        // One shard per thread, cut at record boundaries; small batches aren't worth splitting
+        size_t shardCount = std::min<size_t>(threadCount, std::max<size_t>(1, (end - start) / MIN_SHARD_SIZE));
+        std::vector<size_t> cuts(1, start);
+        for (size_t shard = 1; shard < shardCount; shard++) {
+            size_t cut = GtfsCsvReader::findRecordEnd(data.substr(0, end), start + (end - start) * shard / shardCount,
+                                                      cuts.back());
+            cuts.push_back(std::max(cuts.back(), std::min(cut, end)));
         }
-    }
-    
-    // Read stop_times.txt to get station sequences and actual times
-    std::string stopTimesData = readFileFromAssets("DMRC_GTFS/stop_times.txt");
-    
-    // Map to store sequence of stops and times for each trip
-    std::unordered_map<std::string, std::vector<std::tuple<int, int, std::string, std::string>>> tripStops; 
-    // tripId -> [(stopId, stopSequence, arrivalTime, departureTime)]
-    
-    std::istringstream stopTimesStream(stopTimesData);
-    
-    // Skip header
-    std::getline(stopTimesStream, line);
-    
-    // Parse stop times
-    while (std::getline(stopTimesStream, line)) {
-        std::istringstream lineStream(line);
-        std::string cell;
-        std::vector<std::string> tokens;
+        cuts.push_back(end);
         
-        while (std::getline(lineStream, cell, ',')) {
-            tokens.push_back(cell);
+        shardRows.resize(shardCount);
+        std::vector<std::function<void()>> tasks;
+        for (size_t shard = 0; shard < shardCount; shard++) {
+            tasks.push_back([&, shard]() {
+                std::vector<StopTimeRow>& rows = shardRows[shard];
+                rows.clear();
+                GtfsCsvReader reader(data.substr(cuts[shard], cuts[shard + 1] - cuts[shard]), *header);
+                while (reader.next()) {
+                    int stopId, stopSequence;
+                    if (reader.getInt(stopColumn, stopId) && reader.getInt(sequenceColumn, stopSequence)) {
+                        rows.push_back(StopTimeRow{std::string(reader.getField(tripColumn)), stopId, stopSequence,
+                                                   parseTime(reader.getField(arrivalColumn)),
+                                                   parseTime(reader.getField(departureColumn))});
+                    }
+                }
+            });
         }
+        TaskPool::shared().run(tasks, threadCount);
         
-        if (tokens.size() >= 5) {
-            std::string tripId = tokens[0];
-            std::string arrivalTime = tokens[1];
-            std::string departureTime = tokens[2];
-            int stopId = std::stoi(tokens[3]);
-            int stopSequence = std::stoi(tokens[4]);
-            
-            tripStops[tripId].push_back(std::make_tuple(stopId, stopSequence, arrivalTime, departureTime));
+        for (size_t shard = 0; shard < shardCount; shard++) {
+            for (const StopTimeRow& row : shardRows[shard]) {
+                if (!visit(row)) {
+                    return;
+                }
+            }
         }
+        
+        // Carry the cut-off record over
+        std::memmove(&batch[0], batch.data() + end, filled - end);
+        filled -= end;
     }
+}
+
+// Parse stop_times.txt to build connections between stations
+void MetroDataParser::parseTripData(std::unordered_map<std::string, TripInfo>& trips) {
+    LOGI("Parsing trip data");
     
-    // Sort stop sequences and create edges
-    for (auto& pair : tripStops) {
-        const std::string& tripId = pair.first;
-        auto& stops = pair.second;
-        
+    // Trips running the same stops on the same route share a pattern, so each pattern's
+    // hops become edges once however many trips run it. Run times are still gathered
+    // from every trip, per (source, target, route) in the direction the trip runs
+    std::vector<TripPattern> patterns;
+    std::map<std::pair<int, std::vector<int>>, size_t> patternIndex;
+    std::unordered_map<HopKey, RunTimeCounts, HopKeyHash> runTimes;
+    size_t firstTimetableTrip = timetable ? timetable->trips.size() : 0;
+    std::vector<int> stopIds;
+    
+    // Add a trip's stops (stopId, stopSequence, arrivalSeconds, departureSeconds) to
+    // the patterns, run times and timetable
+    auto collectTrip = [&](const std::string& tripId, std::vector<std::tuple<int, int, int, int>>& stops) {
         // Skip if we don't know the route
-        if (tripToRoute.find(tripId) == tripToRoute.end()) {
-            continue;
+        auto info = trips.find(tripId);
+        if (info == trips.end()) {
+            return;
         }
-        
-        int routeId = tripToRoute[tripId];
+        info->second.collected = true;
+        int routeId = info->second.routeId;
         
         // Sort by sequence
         std::sort(stops.begin(), stops.end(), 
@@ -199,32 +382,154 @@ void MetroDataParser::parseTripData() {
                      return std::get<1>(a) < std::get<1>(b);
                  });
         
-        // Create edges between consecutive stops
-        for (size_t i = 0; i < stops.size() - 1; i++) {
-            int sourceId = std::get<0>(stops[i]);
-            int targetId = std::get<0>(stops[i + 1]);
-            std::string sourceDepartureTime = std::get<3>(stops[i]);
-            std::string targetArrivalTime = std::get<2>(stops[i + 1]);
+        // Keep the timed trip for the timetable engines; trips with a missing time are left out
+        if (timetable) {
+            TimetableTrip trip;
+            trip.routeId = routeId;
+            trip.serviceIndex = info->second.serviceIndex;
             
-            const MetroStation* source = graph.getStation(sourceId);
-            const MetroStation* target = graph.getStation(targetId);
+            bool timed = true;
+            for (const auto& stop : stops) {
+                trip.stopIds.push_back(std::get<0>(stop));
+                trip.arrivalTimes.push_back(std::get<2>(stop));
+                trip.departureTimes.push_back(std::get<3>(stop));
+                timed = timed && trip.arrivalTimes.back() >= 0 && trip.departureTimes.back() >= 0;
+            }
+            if (timed) {
+                timetable->trips.push_back(std::move(trip));
+            }
+        }
+        
+        stopIds.clear();
+        for (const auto& stop : stops) {
+            stopIds.push_back(std::get<0>(stop));
+        }
+        auto inserted = patternIndex.emplace(std::make_pair(routeId, stopIds), patterns.size());
+        if (inserted.second) {
+            patterns.push_back(TripPattern{routeId, stopIds, 0});
+        }
+        patterns[inserted.first->second].tripCount++;
+        
+        for (size_t i = 0; i + 1 < stops.size(); i++) {
+            // Run time from leaving one stop to reaching the next; missing or
+            // non-increasing times tell nothing about the run
+            int sourceDeparture = std::get<3>(stops[i]);
+            int targetArrival = std::get<2>(stops[i + 1]);
+            if (sourceDeparture >= 0 && targetArrival > sourceDeparture) {
+                int sourceId = std::get<0>(stops[i]);
+                int targetId = std::get<0>(stops[i + 1]);
+                addRunTime(runTimes[HopKey{sourceId, targetId, routeId}], targetArrival - sourceDeparture);
+            }
+        }
+    };
+    
+    // GTFS feeds list stop_times.txt trip by trip, so each trip is collected once the
+    // next one starts and only its stops are held. A feed whose trips turn out to be
+    // interleaved is read again, holding every trip's stops until the end
+    bool groupedByTrip = true;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        // tripId -> [(stopId, stopSequence, arrivalSeconds, departureSeconds)]
+        std::unordered_map<std::string, std::vector<std::tuple<int, int, int, int>>> tripStops;
+        std::string currentTripId;
+        std::vector<std::tuple<int, int, int, int>> currentStops;
+        bool interleaved = false;
+        
+        // Parse stop times
+        readStopTimes([&](const StopTimeRow& row) {
+            std::tuple<int, int, int, int> stop(row.stopId, row.stopSequence, row.arrivalSeconds, row.departureSeconds);
+            if (!groupedByTrip) {
+                tripStops[row.tripId].push_back(stop);
+            } else if (row.tripId == currentTripId) {
+                currentStops.push_back(stop);
+            } else {
+                if (!currentStops.empty()) {
+                    collectTrip(currentTripId, currentStops);
+                }
+                currentTripId = row.tripId;
+                currentStops.assign(1, stop);
+                auto info = trips.find(currentTripId);
+                if (info != trips.end() && info->second.collected) {
+                    interleaved = true;
+                    return false;
+                }
+            }
+            return true;
+        });
+        
+        if (interleaved) {
+            LOGI("stop_times.txt is not grouped by trip, reading it again");
+            groupedByTrip = false;
+            for (auto& pair : trips) {
+                pair.second.collected = false;
+            }
+            patterns.clear();
+            patternIndex.clear();
+            runTimes.clear();
+            if (timetable) {
+                timetable->trips.resize(firstTimetableTrip);
+            }
+            continue;
+        }
+        if (!currentStops.empty()) {
+            collectTrip(currentTripId, currentStops);
+        }
+        for (auto& pair : tripStops) {
+            collectTrip(pair.first, pair.second);
+        }
+        break;
+    }
+    
+    // Station pairs some route has timed runs for, keyed with lineId -1
+    std::unordered_set<HopKey, HopKeyHash> timedHops;
+    for (const auto& pair : runTimes) {
+        timedHops.insert(HopKey{pair.first.fromId, pair.first.toId, -1});
+    }
+    
+    // Create one edge per (source, target, route) over all patterns, timed by the median run
+    std::unordered_set<HopKey, HopKeyHash> addedEdges;
+    for (const TripPattern& pattern : patterns) {
+        for (size_t i = 0; i + 1 < pattern.stopIds.size(); i++) {
+            const MetroStation* source = graph.getStation(pattern.stopIds[i]);
+            const MetroStation* target = graph.getStation(pattern.stopIds[i + 1]);
+            if (!source || !target) {
+                continue;
+            }
             
-            if (source && target) {
-                // Calculate distance
-                double dist = calculateDistance(
-                    source->latitude, source->longitude,
-                    target->latitude, target->longitude
-                );
-                
-                // Calculate actual travel time from GTFS data
-                double time = calculateTimeDifference(sourceDepartureTime, targetArrivalTime);
-                
-                // Add edge in both directions (assuming metro can travel both ways with same time)
-                graph.addEdge(MetroEdge(sourceId, targetId, routeId, dist, time));
-                graph.addEdge(MetroEdge(targetId, sourceId, routeId, dist, time));
+            // Calculate distance
+            double dist = calculateDistance(
+                source->latitude, source->longitude,
+                target->latitude, target->longitude
+            );
+            
+            // Add edge in both directions (assuming metro can travel both ways); each is
+            // timed by the trips running that way. A reverse hop no trip of the route
+            // runs is left out if another route runs it with times, and otherwise
+            // gets DEFAULT_HOP_MINUTES
+            for (int direction = 0; direction < 2; direction++) {
+                int fromId = direction == 0 ? source->id : target->id;
+                int toId = direction == 0 ? target->id : source->id;
+                HopKey key{fromId, toId, pattern.routeId};
+                auto it = runTimes.find(key);
+                if (direction == 1 && it == runTimes.end() && timedHops.count(HopKey{fromId, toId, -1})) {
+                    continue;
+                }
+                if (!addedEdges.insert(key).second) {
+                    continue;
+                }
+                EdgeTiming timing;
+                if (it != runTimes.end()) {
+                    timing = summarizeRunTimes(it->second);
+                }
+                double time = timing.tripCount > 0 ? timing.medianSeconds / 60.0 : DEFAULT_HOP_MINUTES;
+                graph.addEdge(MetroEdge(fromId, toId, pattern.routeId, dist, time, timing));
             }
         }
     }
+    size_t tripCount = 0;
+    for (const TripPattern& pattern : patterns) {
+        tripCount += pattern.tripCount;
+    }
+    LOGI("Grouped %zu trips into %zu stop patterns, %zu edges", tripCount, patterns.size(), addedEdges.size());
     
     // Check if any connections were created
     bool hasConnections = false;
@@ -244,6 +549,45 @@ void MetroDataParser::parseTripData() {
     }
 }
 
+// Parse calendar.txt to get the weekdays each service runs on
+std::vector<TimetableService> MetroDataParser::readCalendar() {
+    LOGI("Parsing calendar.txt");
+    
+    std::string calendarData = readFileFromAssets("DMRC_GTFS/calendar.txt");
+    
+    GtfsCsvReader reader(calendarData);
+    int serviceColumn = requireColumn(reader, "service_id", "calendar.txt");
+    int startColumn = requireColumn(reader, "start_date", "calendar.txt");
+    int endColumn = requireColumn(reader, "end_date", "calendar.txt");
+    static const char* const dayNames[] = {
+        "monday", "tuesday", "wednesday", "thursday", "friday", "saturday", "sunday"
+    };
+    int dayColumns[7];
+    for (int day = 0; day < 7; day++) {
+        dayColumns[day] = requireColumn(reader, dayNames[day], "calendar.txt");
+    }
+    
+    // Process each row
+    std::vector<TimetableService> services;
+    while (reader.next()) {
+        // monday .. sunday columns become bits 0 .. 6
+        uint8_t weekdays = 0;
+        bool valid = true;
+        for (int day = 0; day < 7; day++) {
+            int runs;
+            valid = valid && reader.getInt(dayColumns[day], runs);
+            if (valid && runs != 0) {
+                weekdays |= static_cast<uint8_t>(1 << day);
+            }
+        }
+        int startDate, endDate;
+        if (valid && reader.getInt(startColumn, startDate) && reader.getInt(endColumn, endDate)) {
+            services.emplace_back(std::string(reader.getField(serviceColumn)), weekdays, startDate, endDate);
+        }
+    }
+    return services;
+}
+
 // Create fallback connections when GTFS data doesn't provide any
 void MetroDataParser::createFallbackConnections() {
     auto stationIds = graph.getAllStationIds();
@@ -343,11 +687,128 @@ void MetroDataParser::createFallbackConnections() {
     LOGI("Created a total of %d connections between stations", connectionCount);
 }
 
-// Calculate time difference between two time strings in minutes
-double MetroDataParser::calculateTimeDifference(const std::string& startTime, const std::string& endTime) {
-    // Always return a fixed time of 3 minutes between any two stations,
-    // regardless of the actual time difference in the data
-    return 3.0;
+// Add walking edges between stations within the footpath radius of each other, using a
+// grid so each station only measures its neighbouring cells
+void MetroDataParser::addFootpaths() {
+    if (!(footpathRadiusKm > 0) || !(walkingSpeedKmPerMinute > 0)) {
+        return;
+    }
+    
+    std::vector<const MetroStation*> stations;
+    for (int id : graph.getAllStationIds()) {
+        stations.push_back(graph.getStation(id));
+    }
+    StationGrid grid(stations, footpathRadiusKm);
+    
+    int footpathCount = 0;
+    std::vector<const MetroStation*> nearby;
+    for (const MetroStation* station : stations) {
+        nearby.clear();
+        grid.findWithin(station->latitude, station->longitude, footpathRadiusKm, nearby);
+        
+        // Stations one ride apart keep only the ride
+        std::vector<MetroEdge> rides = graph.getNeighbors(station->id);
+        for (const MetroStation* other : nearby) {
+            bool linked = std::any_of(rides.begin(), rides.end(),
+                                      [&](const MetroEdge& edge) { return edge.targetId == other->id; });
+            if (other->id == station->id || linked) {
+                continue;
+            }
+            
+            double dist = calculateDistance(station->latitude, station->longitude,
+                                            other->latitude, other->longitude);
+            double time = dist / walkingSpeedKmPerMinute + footpathPenaltyMinutes;
+            graph.addEdge(MetroEdge(station->id, other->id, MetroGraph::WALKING_LINE_ID, dist, time));
+            footpathCount++;
+        }
+    }
+    
+    if (footpathCount > 0) {
+        graph.addLine(MetroLine(MetroGraph::WALKING_LINE_ID, "Walk", ""));
+    }
+    LOGI("Added %d footpaths within %.2f km", footpathCount, footpathRadiusKm);
+}
+
+// Parse a GTFS time (HH:MM:SS, or H:MM:SS) into seconds after midnight. A malformed
+// time reads as untimed, like an empty one, so one bad row doesn't stop the load
+int MetroDataParser::parseTime(std::string_view time) {
+    while (!time.empty() && time.front() == ' ') {
+        time.remove_prefix(1);
+    }
+    while (!time.empty() && time.back() == ' ') {
+        time.remove_suffix(1);
+    }
+    if (time.empty()) {
+        return -1;
+    }
+    
+    // Hours may have any number of digits, as service days can run past midnight;
+    // minutes and seconds have two
+    size_t position = 0;
+    int hours = 0;
+    while (position < time.size() && position < 4 && time[position] >= '0' && time[position] <= '9') {
+        hours = hours * 10 + (time[position++] - '0');
+    }
+    auto twoDigits = [&](int& value) {
+        if (position + 3 > time.size() || time[position] != ':' ||
+            time[position + 1] < '0' || time[position + 1] > '5' ||
+            time[position + 2] < '0' || time[position + 2] > '9') {
+            return false;
+        }
+        value = (time[position + 1] - '0') * 10 + (time[position + 2] - '0');
+        position += 3;
+        return true;
+    };
+    int minutes = 0, seconds = 0;
+    if (position == 0 || !twoDigits(minutes) || !twoDigits(seconds) || position != time.size()) {
+        return -1;
+    }
+    
+    return hours * 3600 + minutes * 60 + seconds;
+}
+
+// Count one more trip taking this many seconds over a hop
+void MetroDataParser::addRunTime(RunTimeCounts& counts, int seconds) {
+    for (auto& count : counts) {
+        if (count.first == seconds) {
+            count.second++;
+            return;
+        }
+    }
+    counts.emplace_back(seconds, 1);
+}
+
+// Minimum, median and 90th percentile (nearest rank) of a hop's run times
+EdgeTiming MetroDataParser::summarizeRunTimes(RunTimeCounts& counts) {
+    EdgeTiming timing;
+    if (counts.empty()) {
+        return timing;
+    }
+    std::sort(counts.begin(), counts.end());
+    size_t total = 0;
+    for (const auto& count : counts) {
+        total += count.second;
+    }
+    
+    // Seconds of the rank-th fastest run (1-based)
+    auto atRank = [&counts](size_t rank) {
+        size_t seen = 0;
+        for (const auto& count : counts) {
+            seen += count.second;
+            if (seen >= rank) {
+                return count.first;
+            }
+        }
+        return counts.back().first;
+    };
+    auto clamp = [](size_t value) {
+        return static_cast<uint16_t>(std::min<size_t>(value, std::numeric_limits<uint16_t>::max()));
+    };
+    timing.minSeconds = clamp(counts.front().first);
+    timing.medianSeconds = clamp(atRank((total + 1) / 2));
+    timing.p90Seconds = clamp(atRank((total * 9 + 9) / 10));
+    timing.tripCount = clamp(total);
+    return timing;
 }
 
 // Read file from assets
@@ -379,24 +840,17 @@ std::string MetroDataParser::readFileFromAssets(const std::string& filename) {
     return content;
 }
 
+// Column of a header name that a file can't be parsed without
+int MetroDataParser::requireColumn(const GtfsCsvReader& reader, const char* name, const char* filename) {
+    int column = reader.getColumn(name);
+    if (column < 0) {
+        throw std::runtime_error(std::string(filename) + " has no " + name + " column");
+    }
+    return column;
+}
+
 // Calculate distance between two points using Haversine formula
 double MetroDataParser::calculateDistance(double lat1, double lon1, double lat2, double lon2) {
-    // Earth radius in kilometers
-    const double R = 6371.0;
-    
-    // Convert degrees to radians
-    double dLat = (lat2 - lat1) * M_PI / 180.0;
-    double dLon = (lon2 - lon1) * M_PI / 180.0;
-    
-    // Convert to radians
-    lat1 = lat1 * M_PI / 180.0;
-    lat2 = lat2 * M_PI / 180.0;
-    
-    // Apply Haversine formula
-    double a = sin(dLat/2) * sin(dLat/2) +
-               sin(dLon/2) * sin(dLon/2) * cos(lat1) * cos(lat2);
-    double c = 2 * atan2(sqrt(a), sqrt(1-a));
-    double d = R * c;
-    
-    return d;
+    // Shared with the A* heuristic so lower bounds match edge distances exactly
+    return haversineDistance(lat1, lon1, lat2, lon2);
 } 
\ No newline at end of file
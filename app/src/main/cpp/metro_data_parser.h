@@ -2,9 +2,14 @@
 #define METRO_DATA_PARSER_H
 
 #include "metro_graph.h"
+#include "timetable.h"
+#include "gtfs_csv_reader.h"
+#include <functional>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <android/asset_manager.h>
 #include <android/asset_manager_jni.h>
 
@@ -13,12 +18,81 @@ class MetroDataParser {
 private:
     MetroGraph& graph;
     AAssetManager* assetManager;
+    Timetable* timetable = nullptr;
+    
+    // Walking edges between nearby stations (radius 0 disables them); off until
+    // setFootpaths is called
+    double footpathRadiusKm = 0;
+    double walkingSpeedKmPerMinute = DEFAULT_WALKING_SPEED_KM_PER_MINUTE;
+    double footpathPenaltyMinutes = DEFAULT_FOOTPATH_PENALTY_MINUTES;
+    
+    // Threads the GTFS files are tokenized on (0 = one per core)
+    unsigned parseThreads = 0;
+    
+    // stop_times.txt is tokenized this many bytes at a time, in shards of at least
+    // MIN_SHARD_SIZE bytes
+    static constexpr size_t STOP_TIMES_BATCH_SIZE = 1 << 20;
+    static constexpr size_t MIN_SHARD_SIZE = 64 * 1024;
+    
+    // A trip from trips.txt, and whether its stops have been collected yet
+    struct TripInfo {
+        int routeId;
+        int serviceIndex;   // into the timetable's services, -1 if not there
+        bool collected;
+    };
+    
+    // Stop sequence run by trips of a route, and how many trips run it
+    struct TripPattern {
+        int routeId;
+        std::vector<int> stopIds;
+        int tripCount;
+    };
+    
+    // A directed hop of a route, for gathering the run times seen on it
+    struct HopKey {
+        int fromId;
+        int toId;
+        int lineId;
+        bool operator==(const HopKey& other) const {
+            return fromId == other.fromId && toId == other.toId && lineId == other.lineId;
+        }
+    };
+    struct HopKeyHash {
+        size_t operator()(const HopKey& key) const {
+            uint64_t stations = (static_cast<uint64_t>(static_cast<uint32_t>(key.fromId)) << 32) |
+                                static_cast<uint32_t>(key.toId);
+            return std::hash<uint64_t>()(stations * 31 + static_cast<uint32_t>(key.lineId));
+        }
+    };
+    
+    // A row of stop_times.txt, times in seconds after midnight (-1 if empty)
+    struct StopTimeRow {
+        std::string tripId;
+        int stopId;
+        int stopSequence;
+        int arrivalSeconds;
+        int departureSeconds;
+    };
+    
+    // Read a file into plain records. These only touch the assets, so they can run on
+    // worker threads while the graph is left alone
+    std::vector<MetroStation> readStops();
+    std::vector<MetroLine> readRoutes();
+    std::vector<TimetableService> readCalendar();
+    std::unordered_map<std::string, TripInfo> readTrips(const std::vector<TimetableService>& services);
+    
+    // Pass the rows of stop_times.txt to visit in file order until it returns false.
+    // The file is read in batches cut at record boundaries, and each batch is split
+    // into shards tokenized on the parse threads
+    void readStopTimes(const std::function<bool(const StopTimeRow&)>& visit);
     
     // Internal parsing functions
-    void parseStops();
-    void parseRoutes();
-    void parseTripData();
+    void parseTripData(std::unordered_map<std::string, TripInfo>& trips);
     void createFallbackConnections();
+    void addFootpaths();
+    
+    // Column of a header name the file can't be parsed without; throws if it is missing
+    static int requireColumn(const GtfsCsvReader& reader, const char* name, const char* filename);
     
     // Helper function to read a file from assets
     std::string readFileFromAssets(const std::string& filename);
@@ -26,16 +100,55 @@ private:
     // Calculate distance between two geographic points (Haversine formula)
     double calculateDistance(double lat1, double lon1, double lat2, double lon2);
     
-    // Calculate time difference between two GTFS time strings (format HH:MM:SS)
-    double calculateTimeDifference(const std::string& startTime, const std::string& endTime);
+    // Seconds after midnight of a GTFS time (HH:MM:SS, hours may exceed 23); -1 if
+    // empty or malformed
+    static int parseTime(std::string_view time);
+    
+    // Number of trips taking each run time (in seconds) over a hop
+    using RunTimeCounts = std::vector<std::pair<int, int>>;
+    static void addRunTime(RunTimeCounts& counts, int seconds);
+    
+    // Run-time statistics of a hop from its counts (sorts them)
+    static EdgeTiming summarizeRunTimes(RunTimeCounts& counts);
 
 public:
+    // Suggested footpath settings for setFootpaths: 500 m at 5 km/h, plus 5 minutes
+    // for leaving one station and entering the other
+    static constexpr double DEFAULT_FOOTPATH_RADIUS_KM = 0.5;
+    static constexpr double DEFAULT_WALKING_SPEED_KM_PER_MINUTE = 5.0 / 60.0;
+    static constexpr double DEFAULT_FOOTPATH_PENALTY_MINUTES = 5.0;
+    
+    // Time of a hop whose trips give no usable run times
+    static constexpr double DEFAULT_HOP_MINUTES = 3.0;
+    
     // Constructor
     MetroDataParser(MetroGraph& metroGraph, AAssetManager* manager)
         : graph(metroGraph), assetManager(manager) {}
     
+    // Also keep calendars and timed trips in this timetable during parseGTFSData (optional)
+    void setTimetable(Timetable* output) { timetable = output; }
+    
+    // Link stations within radiusKm of each other by walking edges taking
+    // distance / speedKmPerMinute + penaltyMinutes (applies to the next parseGTFSData)
+    void setFootpaths(double radiusKm, double speedKmPerMinute, double penaltyMinutes) {
+        footpathRadiusKm = radiusKm;
+        walkingSpeedKmPerMinute = speedKmPerMinute;
+        footpathPenaltyMinutes = penaltyMinutes;
+    }
+    
+    // Tokenize the GTFS files on up to threadCount threads of the shared TaskPool (0 =
+    // all of them, one per core); the graph is the same for any count
+    void setParseThreads(unsigned threadCount) { parseThreads = threadCount; }
+    
     // Parse all GTFS data and build the metro graph
     bool parseGTFSData();
+    
+    // Hash of the GTFS files and settings parseGTFSData would build from
+    uint64_t computeSourceHash();
+    
+    // Rebuild the graph (and timetable) from a snapshot at snapshotPath made from the
+    // same sources; otherwise parse the GTFS files and save a snapshot there
+    bool loadGTFSData(const std::string& snapshotPath);
 };
 
 #endif // METRO_DATA_PARSER_H 
\ No newline at end of file
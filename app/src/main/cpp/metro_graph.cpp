@@ -1,16 +1,76 @@
 #include "metro_graph.h"
 #include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 #include <vector>
 
+// Colour family of a line name: the part before the first space, lowercased
+// (e.g. "magenta" from "Magenta Line"); names without a space are used whole
+static std::string getLineColorName(const std::string& lineName) {
+    size_t spacePos = lineName.find(' ');
+    if (spacePos != std::string::npos) {
+        std::string colorName = lineName.substr(0, spacePos);
+        std::transform(colorName.begin(), colorName.end(), colorName.begin(),
+                      [](unsigned char c){ return std::tolower(c); });
+        return colorName;
+    }
+    return lineName;
+}
+
+// Fold the bytes of a value into a 64-bit FNV-1a hash
+template <typename T>
+static void hashValue(uint64_t& hash, const T& value) {
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    for (unsigned char byte : bytes) {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    }
+}
+
+// Calculate distance between two points using Haversine formula
+double haversineDistance(double lat1, double lon1, double lat2, double lon2) {
+    // Earth radius in kilometers
+    const double R = 6371.0;
+    
+    // Convert degrees to radians
+    double dLat = (lat2 - lat1) * M_PI / 180.0;
+    double dLon = (lon2 - lon1) * M_PI / 180.0;
+    
+    // Convert to radians
+    lat1 = lat1 * M_PI / 180.0;
+    lat2 = lat2 * M_PI / 180.0;
+    
+    // Apply Haversine formula
+    double a = sin(dLat/2) * sin(dLat/2) +
+               sin(dLon/2) * sin(dLon/2) * cos(lat1) * cos(lat2);
+    double c = 2 * atan2(sqrt(a), sqrt(1-a));
+    double d = R * c;
+    
+    return d;
+}
+
 void MetroGraph::addStation(const MetroStation& station) {
+    if (frozen) {
+        throw std::logic_error("Cannot add a station to a frozen graph");
+    }
     stations[station.id] = station;
 }
 
 void MetroGraph::addLine(const MetroLine& line) {
+    if (frozen) {
+        throw std::logic_error("Cannot add a line to a frozen graph");
+    }
     lines[line.id] = line;
 }
 
 void MetroGraph::addEdge(const MetroEdge& edge) {
+    if (frozen) {
+        throw std::logic_error("Cannot add an edge to a frozen graph");
+    }
     adjacencyList[edge.sourceId].push_back(edge);
 }
 
@@ -51,13 +111,29 @@ const MetroLine* MetroGraph::getLine(int id) const {
     return nullptr;
 }
 
-const std::vector<MetroEdge>& MetroGraph::getNeighbors(int stationId) const {
-    static const std::vector<MetroEdge> emptyVector;
+std::vector<MetroEdge> MetroGraph::getNeighbors(int stationId) const {
+    if (frozen) {
+        std::vector<MetroEdge> result;
+        int index = getStationIndex(stationId);
+        if (index < 0) {
+            return result;
+        }
+        
+        CsrEdgeRange edges = getEdges(index);
+        result.reserve(edges.size());
+        for (const CsrEdge& edge : edges) {
+            result.emplace_back(stationId, indexToStationId[edge.targetIndex],
+                                indexToLineId[edge.lineIndex], edge.distance, edge.time,
+                                edgeTimings[getEdgeIndex(edge)]);
+        }
+        return result;
+    }
+    
     auto it = adjacencyList.find(stationId);
     if (it != adjacencyList.end()) {
         return it->second;
     }
-    return emptyVector;
+    return std::vector<MetroEdge>();
 }
 
 std::vector<int> MetroGraph::getAllStationIds() const {
@@ -71,8 +147,271 @@ std::vector<int> MetroGraph::getAllStationIds() const {
     return ids;
 }
 
+int MetroGraph::getStationIndex(int stationId) const {
+    auto it = stationIdToIndex.find(stationId);
+    if (it != stationIdToIndex.end()) {
+        return it->second;
+    }
+    return -1;
+}
+
+int MetroGraph::getLineIndex(int lineId) const {
+    auto it = lineIdToIndex.find(lineId);
+    if (it != lineIdToIndex.end()) {
+        return it->second;
+    }
+    return -1;
+}
+
+int MetroGraph::countInterchangesAt(const std::vector<int>& lineIndices) const {
+    // Walks are skipped, so the rides on either side of one are compared
+    int count = 0;
+    int lastRide = -1;
+    for (int line : lineIndices) {
+        if (indexToLineId[line] == WALKING_LINE_ID) {
+            continue;
+        }
+        if (lastRide >= 0 && isInterchangeAt(lastRide, line)) {
+            count++;
+        }
+        lastRide = line;
+    }
+    return count;
+}
+
+bool MetroGraph::isInterchange(int fromLineId, int toLineId) const {
+    // If they have the same ID, they're definitely the same line
+    if (fromLineId == toLineId) {
+        return false;
+    }
+    
+    int fromIndex = getLineIndex(fromLineId);
+    int toIndex = getLineIndex(toLineId);
+    if (fromIndex < 0 || toIndex < 0) {
+        return true;
+    }
+    return isInterchangeAt(fromIndex, toIndex);
+}
+
+void MetroGraph::freeze() {
+    if (frozen) {
+        return;
+    }
+    
+    // Dense indices follow ascending stop_id so the layout doesn't depend on hash order
+    indexToStationId = getAllStationIds();
+    std::sort(indexToStationId.begin(), indexToStationId.end());
+    
+    stationIdToIndex.clear();
+    stationIdToIndex.reserve(indexToStationId.size());
+    for (size_t i = 0; i < indexToStationId.size(); i++) {
+        stationIdToIndex[indexToStationId[i]] = static_cast<int>(i);
+    }
+    
+    // Dense line indices cover both routes.txt lines and any line ID used by an edge
+    indexToLineId.clear();
+    for (const auto& pair : lines) {
+        indexToLineId.push_back(pair.first);
+    }
+    for (const auto& pair : adjacencyList) {
+        for (const auto& edge : pair.second) {
+            if (lines.count(edge.lineId) == 0) {
+                indexToLineId.push_back(edge.lineId);
+            }
+        }
+    }
+    std::sort(indexToLineId.begin(), indexToLineId.end());
+    indexToLineId.erase(std::unique(indexToLineId.begin(), indexToLineId.end()), indexToLineId.end());
+    
+    lineIdToIndex.clear();
+    for (size_t i = 0; i < indexToLineId.size(); i++) {
+        lineIdToIndex[indexToLineId[i]] = static_cast<int>(i);
+    }
+    
+    // Intern colour families; a line without a routes.txt entry is its own family
+    std::unordered_map<std::string, int> familyIds;
+    int nextFamily = 0;
+    lineFamily.assign(indexToLineId.size(), -1);
+    for (size_t i = 0; i < indexToLineId.size(); i++) {
+        const MetroLine* line = getLine(indexToLineId[i]);
+        if (line) {
+            auto inserted = familyIds.emplace(getLineColorName(line->name), nextFamily);
+            if (inserted.second) {
+                nextFamily++;
+            }
+            lineFamily[i] = inserted.first->second;
+        } else {
+            lineFamily[i] = nextFamily++;
+        }
+    }
+    
+    size_t lineCount = indexToLineId.size();
+    interchangeTable.assign(lineCount * lineCount, 0);
+    for (size_t a = 0; a < lineCount; a++) {
+        for (size_t b = 0; b < lineCount; b++) {
+            bool walking = indexToLineId[a] == WALKING_LINE_ID || indexToLineId[b] == WALKING_LINE_ID;
+            interchangeTable[a * lineCount + b] = (a != b && !walking && lineFamily[a] != lineFamily[b]) ? 1 : 0;
+        }
+    }
+    
+    // Count edges per station first so the packed array is allocated once
+    edgeOffsets.assign(indexToStationId.size() + 1, 0);
+    for (size_t i = 0; i < indexToStationId.size(); i++) {
+        auto it = adjacencyList.find(indexToStationId[i]);
+        int count = 0;
+        if (it != adjacencyList.end()) {
+            for (const auto& edge : it->second) {
+                // Edges to unknown stations were never reachable, so they are dropped here
+                if (stationIdToIndex.count(edge.targetId) > 0) {
+                    count++;
+                }
+            }
+        }
+        edgeOffsets[i + 1] = edgeOffsets[i] + count;
+    }
+    
+    // Pack edges, keeping each station's insertion order
+    csrEdges.clear();
+    csrEdges.reserve(edgeOffsets.back());
+    edgeTimings.clear();
+    edgeTimings.reserve(edgeOffsets.back());
+    for (size_t i = 0; i < indexToStationId.size(); i++) {
+        auto it = adjacencyList.find(indexToStationId[i]);
+        if (it == adjacencyList.end()) {
+            continue;
+        }
+        for (const auto& edge : it->second) {
+            auto target = stationIdToIndex.find(edge.targetId);
+            if (target != stationIdToIndex.end()) {
+                csrEdges.push_back(CsrEdge{target->second, lineIdToIndex[edge.lineId],
+                                           edge.distance, edge.time});
+                edgeTimings.push_back(edge.timing);
+            }
+        }
+    }
+    
+    // Coordinates by dense index and the fastest edge, for A* lower bounds
+    stationLatitudes.resize(indexToStationId.size());
+    stationLongitudes.resize(indexToStationId.size());
+    for (size_t i = 0; i < indexToStationId.size(); i++) {
+        const MetroStation& station = stations.at(indexToStationId[i]);
+        stationLatitudes[i] = station.latitude;
+        stationLongitudes[i] = station.longitude;
+    }
+    
+    maxEdgeSpeed = 0;
+    for (const CsrEdge& edge : csrEdges) {
+        if (edge.time > 0) {
+            maxEdgeSpeed = std::max(maxEdgeSpeed, edge.distance / edge.time);
+        } else if (edge.distance > 0) {
+            // A zero-time hop has no speed bound; time-mode A* degrades to Dijkstra
+            maxEdgeSpeed = std::numeric_limits<double>::infinity();
+        }
+    }
+    
+    buildLineStates();
+    
+    // Fingerprint recorded by data derived from this layout, e.g. cached route tables
+    fingerprint = 14695981039346656037ULL;
+    for (int stationId : indexToStationId) {
+        hashValue(fingerprint, stationId);
+    }
+    for (size_t i = 0; i < indexToLineId.size(); i++) {
+        hashValue(fingerprint, indexToLineId[i]);
+        hashValue(fingerprint, lineFamily[i]);
+    }
+    for (int offset : edgeOffsets) {
+        hashValue(fingerprint, offset);
+    }
+    for (const CsrEdge& edge : csrEdges) {
+        hashValue(fingerprint, edge.targetIndex);
+        hashValue(fingerprint, edge.lineIndex);
+        hashValue(fingerprint, edge.distance);
+        hashValue(fingerprint, edge.time);
+    }
+    
+    // The build-time adjacency lists are no longer needed
+    std::unordered_map<int, std::vector<MetroEdge>>().swap(adjacencyList);
+    frozen = true;
+}
+
+void MetroGraph::buildLineStates() {
+    size_t stationCount = indexToStationId.size();
+    
+    // A station gets one state per distinct line arriving at it, ordered by line index
+    std::vector<std::vector<int>> arrivingLines(stationCount);
+    for (const CsrEdge& edge : csrEdges) {
+        arrivingLines[edge.targetIndex].push_back(edge.lineIndex);
+    }
+    
+    stateOffsets.assign(stationCount + 1, 0);
+    stateStation.clear();
+    stateLine.clear();
+    for (size_t i = 0; i < stationCount; i++) {
+        std::vector<int>& stationLines = arrivingLines[i];
+        std::sort(stationLines.begin(), stationLines.end());
+        stationLines.erase(std::unique(stationLines.begin(), stationLines.end()), stationLines.end());
+        
+        for (int lineIndex : stationLines) {
+            stateStation.push_back(static_cast<int>(i));
+            stateLine.push_back(lineIndex);
+        }
+        stateOffsets[i + 1] = static_cast<int>(stateStation.size());
+    }
+    
+    // Resolve the state each packed edge arrives in
+    edgeTargetState.resize(csrEdges.size());
+    for (size_t e = 0; e < csrEdges.size(); e++) {
+        const CsrEdge& edge = csrEdges[e];
+        auto first = stateLine.begin() + stateOffsets[edge.targetIndex];
+        auto last = stateLine.begin() + stateOffsets[edge.targetIndex + 1];
+        edgeTargetState[e] = static_cast<int>(std::lower_bound(first, last, edge.lineIndex) - stateLine.begin());
+    }
+    
+    // Reverse CSR grouped by arriving state, keeping forward edge order within a state
+    size_t stateCount = stateStation.size();
+    reverseOffsets.assign(stateCount + 1, 0);
+    for (int state : edgeTargetState) {
+        reverseOffsets[state + 1]++;
+    }
+    for (size_t s = 0; s < stateCount; s++) {
+        reverseOffsets[s + 1] += reverseOffsets[s];
+    }
+    
+    reverseEdges.resize(csrEdges.size());
+    std::vector<int> fill(reverseOffsets.begin(), reverseOffsets.end() - 1);
+    for (size_t u = 0; u < stationCount; u++) {
+        for (int e = edgeOffsets[u]; e < edgeOffsets[u + 1]; e++) {
+            const CsrEdge& edge = csrEdges[e];
+            reverseEdges[fill[edgeTargetState[e]]++] =
+                ReverseCsrEdge{static_cast<int>(u), edge.distance, edge.time};
+        }
+    }
+}
+
 void MetroGraph::clear() {
     stations.clear();
     lines.clear();
     adjacencyList.clear();
+    
+    frozen = false;
+    indexToStationId.clear();
+    stationIdToIndex.clear();
+    edgeOffsets.clear();
+    csrEdges.clear();
+    edgeTimings.clear();
+    indexToLineId.clear();
+    lineIdToIndex.clear();
+    lineFamily.clear();
+    interchangeTable.clear();
+    stationLatitudes.clear();
+    stationLongitudes.clear();
+    maxEdgeSpeed = 0;
+    stateOffsets.clear();
+    stateStation.clear();
+    stateLine.clear();
+    edgeTargetState.clear();
+    reverseOffsets.clear();
+    reverseEdges.clear();
+    fingerprint = 0;
 } 
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef METRO_GRAPH_H
 #define METRO_GRAPH_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -36,6 +37,15 @@ struct MetroLine {
         : id(id), name(std::move(name)), color(std::move(color)) {}
 };
 
+// Scheduled run times of an edge over the trips serving it, in seconds; all zero
+// when the edge has no schedule (walking and fallback edges)
+struct EdgeTiming {
+    uint16_t minSeconds = 0;
+    uint16_t medianSeconds = 0;
+    uint16_t p90Seconds = 0;
+    uint16_t tripCount = 0;
+};
+
 // Edge struct to represent connection between stations
 struct MetroEdge {
     int sourceId;
@@ -43,10 +53,40 @@ struct MetroEdge {
     int lineId;
     double distance;     // Distance in km
     double time;         // Time in minutes
+    EdgeTiming timing;
     
     // Constructor
-    MetroEdge(int src, int tgt, int line, double dist, double t) 
-        : sourceId(src), targetId(tgt), lineId(line), distance(dist), time(t) {}
+    MetroEdge(int src, int tgt, int line, double dist, double t, EdgeTiming runTimes = EdgeTiming()) 
+        : sourceId(src), targetId(tgt), lineId(line), distance(dist), time(t), timing(runTimes) {}
+};
+
+// Packed edge stored in the frozen CSR adjacency (target and line are dense indices)
+struct CsrEdge {
+    int targetIndex;
+    int lineIndex;
+    double distance;     // Distance in km
+    double time;         // Time in minutes
+};
+
+// Contiguous slice of one of the CSR arrays (edges of a station, reverse edges of a state)
+template <typename T>
+struct CsrRange {
+    const T* first;
+    const T* last;
+
+    const T* begin() const { return first; }
+    const T* end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    bool empty() const { return first == last; }
+};
+
+using CsrEdgeRange = CsrRange<CsrEdge>;
+
+// Incoming edge of a line-aware state, stored in the reverse CSR for backward searches
+struct ReverseCsrEdge {
+    int sourceIndex;     // Dense index of the station the edge leaves from
+    double distance;     // Distance in km
+    double time;         // Time in minutes
 };
 
 // Path struct to represent a path in the network
@@ -61,6 +101,9 @@ struct MetroPath {
     MetroPath() : totalDistance(0), totalTime(0), interchangeCount(0) {}
 };
 
+// Great-circle distance in km between two coordinates given in degrees (Haversine formula)
+double haversineDistance(double lat1, double lon1, double lat2, double lon2);
+
 // Metro Graph class representing the entire metro network
 class MetroGraph {
 private:
@@ -68,7 +111,50 @@ private:
     std::unordered_map<int, MetroLine> lines;
     std::unordered_map<int, std::vector<MetroEdge>> adjacencyList;
 
+    // Frozen layout built by freeze(): stop_ids remapped to dense indices
+    // (ascending stop_id order) and all edges packed into one CSR array
+    bool frozen = false;
+    std::vector<int> indexToStationId;
+    std::unordered_map<int, int> stationIdToIndex;
+    std::vector<int> edgeOffsets;      // size = station count + 1
+    std::vector<CsrEdge> csrEdges;
+    std::vector<EdgeTiming> edgeTimings; // by packed edge position, kept off the query path
+
+    // Lines remapped to dense indices by freeze(), with colour families
+    // ("magenta" from "Magenta Line") interned to small integer group IDs
+    // and a lineCount x lineCount table of which line changes are real interchanges
+    std::vector<int> indexToLineId;
+    std::unordered_map<int, int> lineIdToIndex;
+    std::vector<int> lineFamily;
+    std::vector<uint8_t> interchangeTable;
+
+    // Station coordinates by dense index and the fastest edge speed (km/min),
+    // used for A* lower bounds
+    std::vector<double> stationLatitudes;
+    std::vector<double> stationLongitudes;
+    double maxEdgeSpeed = 0;
+
+    // Line-aware states: one per (station, arriving line) pair, numbered
+    // contiguously per station, plus the reverse CSR of edges entering each state
+    std::vector<int> stateOffsets;        // size = station count + 1
+    std::vector<int> stateStation;
+    std::vector<int> stateLine;
+    std::vector<int> edgeTargetState;     // state each CSR edge arrives in
+    std::vector<int> reverseOffsets;      // size = state count + 1
+    std::vector<ReverseCsrEdge> reverseEdges;
+
+    // Hash of the frozen layout, so data derived from it can detect a different graph
+    uint64_t fingerprint = 0;
+
+    // Build the line-aware states and reverse CSR from the packed edges
+    void buildLineStates();
+
 public:
+    // Line ID of the walking edges between nearby stations. Changing to or from it is
+    // never an interchange: each walking edge already includes its transfer penalty.
+    // Interchange counts of a path look across a walk, though (see countInterchangesAt).
+    static constexpr int WALKING_LINE_ID = -1;
+
     // Add a station to the graph
     void addStation(const MetroStation& station);
     
@@ -87,12 +173,106 @@ public:
     // Get line by ID
     const MetroLine* getLine(int id) const;
     
-    // Get all neighbors of a station
-    const std::vector<MetroEdge>& getNeighbors(int stationId) const;
-    
+    // Get all neighbors of a station (a copy; query code should use getEdges)
+    std::vector<MetroEdge> getNeighbors(int stationId) const;
+
     // Get all station IDs
     std::vector<int> getAllStationIds() const;
-    
+
+    // Build the dense index and CSR edge array; stations and edges can't be added afterwards
+    void freeze();
+
+    // Whether freeze() has been called since the last clear()
+    bool isFrozen() const { return frozen; }
+
+    // Number of stations in the dense index (frozen graph only)
+    int getStationCount() const { return static_cast<int>(indexToStationId.size()); }
+
+    // Dense index of a stop_id, or -1 if unknown (frozen graph only)
+    int getStationIndex(int stationId) const;
+
+    // Stop_id of a dense index (frozen graph only)
+    int getStationIdAt(int index) const { return indexToStationId[index]; }
+
+    // Outgoing edges of a dense index as a contiguous range (frozen graph only)
+    CsrEdgeRange getEdges(int index) const {
+        const CsrEdge* base = csrEdges.data();
+        return CsrEdgeRange{base + edgeOffsets[index], base + edgeOffsets[index + 1]};
+    }
+
+    // Total number of packed edges (frozen graph only)
+    size_t getEdgeCount() const { return csrEdges.size(); }
+
+    // Packed edge by its position (frozen graph only)
+    const CsrEdge& getEdgeAt(int edgeIndex) const { return csrEdges[edgeIndex]; }
+
+    // Scheduled run times of a packed edge (frozen graph only)
+    const EdgeTiming& getEdgeTiming(int edgeIndex) const { return edgeTimings[edgeIndex]; }
+
+    // Number of lines in the dense line index (frozen graph only)
+    int getLineCount() const { return static_cast<int>(indexToLineId.size()); }
+
+    // Dense index of a line ID, or -1 if unknown (frozen graph only)
+    int getLineIndex(int lineId) const;
+
+    // Line ID of a dense line index (frozen graph only)
+    int getLineIdAt(int index) const { return indexToLineId[index]; }
+
+    // Whether changing between two dense line indices is a real interchange (different colour family)
+    bool isInterchangeAt(int fromLineIndex, int toLineIndex) const {
+        return interchangeTable[static_cast<size_t>(fromLineIndex) * indexToLineId.size() + toLineIndex] != 0;
+    }
+
+    // Interchanges along the lines (dense indices) of a path's hops, for reporting.
+    // Unlike the penalty, this counts riding one line, walking, then riding another
+    // as changing between the two
+    int countInterchangesAt(const std::vector<int>& lineIndices) const;
+
+    // Straight-line distance in km between two dense indices, never more than the
+    // distance of any path between them (frozen graph only)
+    double getStraightLineDistance(int indexA, int indexB) const {
+        return haversineDistance(stationLatitudes[indexA], stationLongitudes[indexA],
+                                 stationLatitudes[indexB], stationLongitudes[indexB]);
+    }
+
+    // Highest distance/time ratio over all edges in km per minute (frozen graph only);
+    // infinity if some hop takes no time, 0 if there are no edges
+    double getMaxEdgeSpeed() const { return maxEdgeSpeed; }
+
+    // Number of line-aware (station, arriving line) states (frozen graph only)
+    int getStateCount() const { return static_cast<int>(stateStation.size()); }
+
+    // First state of a dense station index and one past its last (frozen graph only)
+    int getFirstState(int index) const { return stateOffsets[index]; }
+    int getEndState(int index) const { return stateOffsets[index + 1]; }
+
+    // Station and dense line index of a state (frozen graph only)
+    int getStateStation(int state) const { return stateStation[state]; }
+    int getStateLine(int state) const { return stateLine[state]; }
+
+    // Position of an edge in the packed array and the state it arrives in (frozen graph only)
+    int getEdgeIndex(const CsrEdge& edge) const { return static_cast<int>(&edge - csrEdges.data()); }
+    int getEdgeTargetState(int edgeIndex) const { return edgeTargetState[edgeIndex]; }
+
+    // Edges arriving in a state, for searches that run backwards (frozen graph only)
+    CsrRange<ReverseCsrEdge> getReverseEdges(int state) const {
+        const ReverseCsrEdge* base = reverseEdges.data();
+        return CsrRange<ReverseCsrEdge>{base + reverseOffsets[state], base + reverseOffsets[state + 1]};
+    }
+
+    // Edges arriving at a station on any line: the reverse edges of all its states (frozen graph only)
+    CsrRange<ReverseCsrEdge> getStationReverseEdges(int index) const {
+        const ReverseCsrEdge* base = reverseEdges.data();
+        return CsrRange<ReverseCsrEdge>{base + reverseOffsets[stateOffsets[index]],
+                                        base + reverseOffsets[stateOffsets[index + 1]]};
+    }
+
+    // FNV-1a hash of the dense stations, lines, families and packed edges (frozen graph only)
+    uint64_t getFingerprint() const { return fingerprint; }
+
+    // Same check by line ID; lines unknown to the graph always count as an interchange
+    bool isInterchange(int fromLineId, int toLineId) const;
+
     // Clear all data
     void clear();
 };
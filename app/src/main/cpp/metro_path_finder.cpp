@@ -1,235 +1,706 @@
 #include "metro_path_finder.h"
+#include "task_pool.h"
 #include <algorithm>
+#include <atomic>
 #include <string>
 #include <cctype>
 
-// Helper function to get the line color name (part before the space)
-std::string getLineColorName(const std::string& lineName) {
-    // Find the first space
-    size_t spacePos = lineName.find(' ');
-    if (spacePos != std::string::npos) {
-        // Return part before space, converted to lowercase
-        std::string colorName = lineName.substr(0, spacePos);
-        std::transform(colorName.begin(), colorName.end(), colorName.begin(),
-                      [](unsigned char c){ return std::tolower(c); });
-        return colorName;
+QueryWorkspace& MetroPathFinder::threadWorkspace() {
+    thread_local QueryWorkspace workspace;
+    return workspace;
+}
+
+MetroPath MetroPathFinder::findPathDijkstra(CsrRange<int> sources, CsrRange<int> targets, bool useDistance,
+                                            bool useAStar, QueryWorkspace& workspace) {
+    if (!overlay.isEmpty()) {
+        if (useDistance) {
+            return findPathDijkstra<DijkstraQueue, true>(sources, targets, DistanceCost(), useAStar, workspace);
+        }
+        return findPathOnLines<DijkstraQueue, true>(sources, targets, TimeCost(), useAStar, workspace);
     }
-    return lineName; // Return the whole name if no space found
+    if (useDistance) {
+        return findPathDijkstra<DijkstraQueue, false>(sources, targets, DistanceCost(), useAStar, workspace);
+    }
+    return findPathOnLines<DijkstraQueue, false>(sources, targets, TimeCost(), useAStar, workspace);
+}
+
+MetroPath MetroPathFinder::findPathDijkstra(int sourceId, int targetId, bool useDistance, bool useAStar,
+                                            QueryWorkspace& workspace) {
+    int sourceIndex = graph.getStationIndex(sourceId);
+    int targetIndex = graph.getStationIndex(targetId);
+    if (sourceIndex < 0 || targetIndex < 0) {
+        return MetroPath();
+    }
+    return findPathDijkstra(CsrRange<int>{&sourceIndex, &sourceIndex + 1},
+                            CsrRange<int>{&targetIndex, &targetIndex + 1}, useDistance, useAStar, workspace);
+}
+
+double MetroPathFinder::getTargetDistance(int index, CsrRange<int> targets) const {
+    double nearest = std::numeric_limits<double>::infinity();
+    for (int targetIndex : targets) {
+        nearest = std::min(nearest, graph.getStraightLineDistance(index, targetIndex));
+    }
+    return nearest;
+}
+
+MetroPath MetroPathFinder::reconstructPath(int targetIndex, const QueryWorkspace& workspace) const {
+    MetroPath path;
+    
+    // Count the hops first so the output vectors are sized exactly once; sources have no predecessor
+    size_t hops = 0;
+    int sourceIndex = targetIndex;
+    while (workspace.getPrevNode(sourceIndex) >= 0) {
+        sourceIndex = workspace.getPrevNode(sourceIndex);
+        hops++;
+    }
+    
+    // Fill stations and lines (dense indices for now) from the target backwards
+    path.stationIds.resize(hops + 1);
+    path.lineIds.resize(hops);
+    int currentIndex = targetIndex;
+    for (size_t i = hops; i > 0; i--) {
+        path.stationIds[i] = currentIndex;
+        path.lineIds[i - 1] = workspace.getPrevLine(currentIndex);
+        currentIndex = workspace.getPrevNode(currentIndex);
+    }
+    path.stationIds[0] = sourceIndex;
+    return path;
+}
+
+double MetroPathFinder::assignShortestLines(MetroPath& path) const {
+    path.lineIds.resize(path.stationIds.size() - 1);
+    double running = 0;
+    for (size_t i = 0; i < path.lineIds.size(); i++) {
+        double shortest = std::numeric_limits<double>::infinity();
+        for (const CsrEdge& edge : graph.getEdges(path.stationIds[i])) {
+            if (edge.targetIndex == path.stationIds[i + 1] && running + edge.distance < shortest) {
+                shortest = running + edge.distance;
+                path.lineIds[i] = edge.lineIndex;
+            }
+        }
+        running = shortest;
+    }
+    return running;
+}
+
+double MetroPathFinder::getTimeFactor(int fromIndex, const CsrEdge& edge) const {
+    return overlay.isEmpty() ? 1.0 : overlay.getEdgeFactor(fromIndex, edge.targetIndex, edge.lineIndex);
 }
 
-// Helper function to check if two lines are truly different (comparing names rather than just IDs)
-bool isRealInterchange(const MetroGraph& graph, int prevLineId, int currentLineId) {
-    // If they have the same ID, they're definitely the same line
-    if (prevLineId == currentLineId) {
-        return false;
+double MetroPathFinder::sumPathTime(const MetroPath& path) const {
+    double totalTime = 0;
+    for (size_t i = 0; i < path.lineIds.size(); i++) {
+        for (const CsrEdge& edge : graph.getEdges(path.stationIds[i])) {
+            if (edge.targetIndex == path.stationIds[i + 1] && edge.lineIndex == path.lineIds[i]) {
+                totalTime += edge.time * getTimeFactor(path.stationIds[i], edge);
+                break;
+            }
+        }
+        if (i > 0 && graph.isInterchangeAt(path.lineIds[i - 1], path.lineIds[i])) {
+            totalTime += INTERCHANGE_PENALTY_MINUTES;
+        }
     }
+    return totalTime;
+}
+
+void MetroPathFinder::finishPath(MetroPath& path, double totalCost, bool useDistance) const {
+    // Calculate total distance and time
+    path.totalDistance = 0;
+    path.totalTime = 0;
     
-    // Get the line objects
-    const MetroLine* prevLine = graph.getLine(prevLineId);
-    const MetroLine* currentLine = graph.getLine(currentLineId);
+    // Count REAL interchanges (line changes between different colored lines), also
+    // across walks; only direct changes were charged the penalty
+    path.interchangeCount = graph.countInterchangesAt(path.lineIds);
+    int chargedInterchanges = 0;
+    for (size_t i = 1; i < path.lineIds.size(); i++) {
+        if (graph.isInterchangeAt(path.lineIds[i - 1], path.lineIds[i])) {
+            chargedInterchanges++;
+        }
+    }
     
-    // If either line doesn't exist, consider it an interchange
-    if (!prevLine || !currentLine) {
-        return true;
+    // Sum the metric we didn't optimize for from the first matching edge of each hop
+    double otherTotal = 0;
+    for (size_t i = 0; i < path.lineIds.size(); i++) {
+        for (const CsrEdge& edge : graph.getEdges(path.stationIds[i])) {
+            if (edge.targetIndex == path.stationIds[i + 1] && edge.lineIndex == path.lineIds[i]) {
+                otherTotal += useDistance ? edge.time * getTimeFactor(path.stationIds[i], edge) : edge.distance;
+                break;
+            }
+        }
     }
     
-    // Get color parts of the names (e.g., "magenta" from "Magenta Line")
-    std::string prevColor = getLineColorName(prevLine->name);
-    std::string currentColor = getLineColorName(currentLine->name);
+    // Set the total cost based on what we optimized for
+    if (useDistance) {
+        path.totalDistance = totalCost;
+        
+        // Add the penalty for each REAL interchange
+        path.totalTime = otherTotal + chargedInterchanges * INTERCHANGE_PENALTY_MINUTES;
+    } else {
+        // When optimizing for time, totalCost already includes the interchange penalties
+        path.totalTime = totalCost;
+        path.totalDistance = otherTotal;
+    }
     
-    // It's a real interchange only if the color parts are different
-    return prevColor != currentColor;
+    // Map dense indices back to GTFS stop_ids and line IDs
+    for (int& station : path.stationIds) {
+        station = graph.getStationIdAt(station);
+    }
+    for (int& line : path.lineIds) {
+        line = graph.getLineIdAt(line);
+    }
 }
 
-MetroPath MetroPathFinder::findPathDijkstra(int sourceId, int targetId, bool useDistance) {
-    // Use priority queue for Dijkstra algorithm
-    std::priority_queue<DijkstraNode, std::vector<DijkstraNode>, std::greater<>> pq;
+MetroPath MetroPathFinder::findPathBidirectional(int sourceId, int targetId, bool useDistance,
+                                                 QueryWorkspace& workspace) {
+    if (!graph.isFrozen()) {
+        return MetroPath();
+    }
     
-    // Maps to track the shortest path
-    std::unordered_map<int, double> dist;
-    std::unordered_map<int, int> prevStation;
-    std::unordered_map<int, int> prevLine;
-    std::unordered_set<int> visited;
+    int sourceIndex = graph.getStationIndex(sourceId);
+    int targetIndex = graph.getStationIndex(targetId);
+    if (sourceIndex < 0 || targetIndex < 0) {
+        return MetroPath();
+    }
     
-    // Initialize all distances as infinite
-    for (int id : graph.getAllStationIds()) {
-        dist[id] = std::numeric_limits<double>::infinity();
+    // Trivial query: same answer the forward search gives
+    if (sourceIndex == targetIndex) {
+        MetroPath path;
+        path.stationIds.push_back(sourceIndex);
+        finishPath(path, 0, useDistance);
+        return path;
     }
     
-    // Distance from source to itself is 0
-    dist[sourceId] = 0;
+    // Only time mode has a penalty that depends on the arriving line; distance
+    // mode searches plain stations, which is exact there and much smaller
+    bool lineAware = !useDistance;
+    size_t nodeCount = static_cast<size_t>(lineAware ? graph.getStateCount() : graph.getStationCount());
     
-    // Push source node to priority queue
-    pq.push(DijkstraNode(sourceId, 0, -1, -1));
+    QueryWorkspace& forward = workspace;
+    QueryWorkspace& backward = workspace.backward();
+    forward.begin(nodeCount);
+    backward.begin(nodeCount);
     
-    // Process nodes in priority queue
-    while (!pq.empty()) {
-        DijkstraNode current = pq.top();
-        pq.pop();
+    std::greater<> heapCompare;
+    const double infinity = std::numeric_limits<double>::infinity();
+    double best = infinity;
+    int meetNode = -1;
+    
+    // Forward nodes hold the cost of arriving at a station (on a line); backward
+    // nodes the cost from having arrived there to the target
+    auto relax = [&](QueryWorkspace& side, QueryWorkspace& other, int node, double cost, int prevNode) {
+        side.stats.relaxedEdges++;
+        if (side.getDist(node) <= cost) {
+            return;
+        }
+        side.setDist(node, cost, prevNode, -1);
+        side.heap.push_back(DijkstraNode(node, cost, prevNode, -1));
+        std::push_heap(side.heap.begin(), side.heap.end(), heapCompare);
+        side.stats.heapPushes++;
         
-        int currentId = current.stationId;
+        double total = cost + other.getDist(node);
+        if (total < best) {
+            best = total;
+            meetNode = node;
+        }
+    };
+    
+    if (lineAware) {
+        // The first ride from the source never pays an interchange penalty
+        for (const CsrEdge& edge : graph.getEdges(sourceIndex)) {
+            relax(forward, backward, graph.getEdgeTargetState(graph.getEdgeIndex(edge)), edge.time, -1);
+        }
         
-        // If we've reached the target, we can stop
-        if (currentId == targetId) {
+        // Arriving at the target on any line ends the trip
+        for (int state = graph.getFirstState(targetIndex); state < graph.getEndState(targetIndex); state++) {
+            relax(backward, forward, state, 0, -1);
+        }
+    } else {
+        relax(forward, backward, sourceIndex, 0, -1);
+        relax(backward, forward, targetIndex, 0, -1);
+    }
+    
+    while (!forward.heap.empty() || !backward.heap.empty()) {
+        double topForward = forward.heap.empty() ? infinity : forward.heap.front().cost;
+        double topBackward = backward.heap.empty() ? infinity : backward.heap.front().cost;
+        
+        // No unsettled node on either side can improve the best meeting point
+        if (topForward + topBackward >= best) {
             break;
         }
         
-        // Skip if already processed
-        if (visited.count(currentId) > 0) {
+        // Expand the side whose frontier is closer
+        bool expandForward = topForward <= topBackward;
+        QueryWorkspace& side = expandForward ? forward : backward;
+        std::pop_heap(side.heap.begin(), side.heap.end(), heapCompare);
+        int node = side.heap.back().stationId;
+        side.heap.pop_back();
+        side.stats.heapPops++;
+        
+        if (side.isSettled(node)) {
             continue;
         }
+        side.markSettled(node);
+        side.stats.settledNodes++;
         
-        visited.insert(currentId);
+        double nodeCost = side.getDist(node);
         
-        // Process all neighbors
-        for (const auto& edge : graph.getNeighbors(currentId)) {
-            int neighborId = edge.targetId;
-            double cost = useDistance ? edge.distance : edge.time;
-            
-            // Add interchange penalty (8 minutes) if switching lines and not optimizing for distance
-            // Only add penalty for REAL interchanges (different line colors)
-            if (!useDistance && current.prevStationId != -1 && 
-                isRealInterchange(graph, current.lineId, edge.lineId)) {
-                cost += 8.0; // 8 minute interchange penalty
-            }
-            
-            // If we found a shorter path
-            if (dist[neighborId] > dist[currentId] + cost) {
-                dist[neighborId] = dist[currentId] + cost;
-                prevStation[neighborId] = currentId;
-                prevLine[neighborId] = edge.lineId;
+        if (expandForward) {
+            int station = lineAware ? graph.getStateStation(node) : node;
+            for (const CsrEdge& edge : graph.getEdges(station)) {
+                if (!lineAware) {
+                    relax(forward, backward, edge.targetIndex, nodeCost + edge.distance, node);
+                    continue;
+                }
                 
-                // Add to priority queue
-                pq.push(DijkstraNode(neighborId, dist[neighborId], currentId, edge.lineId));
+                double cost = edge.time;
+                if (graph.isInterchangeAt(graph.getStateLine(node), edge.lineIndex)) {
+                    cost += INTERCHANGE_PENALTY_MINUTES;
+                }
+                relax(forward, backward, graph.getEdgeTargetState(graph.getEdgeIndex(edge)),
+                      nodeCost + cost, node);
+            }
+        } else if (!lineAware) {
+            for (const ReverseCsrEdge& edge : graph.getStationReverseEdges(node)) {
+                relax(backward, forward, edge.sourceIndex, nodeCost + edge.distance, node);
+            }
+        } else {
+            // Every state of the previous station can lead into this one; the penalty
+            // depends on which line that state arrived on
+            int line = graph.getStateLine(node);
+            for (const ReverseCsrEdge& edge : graph.getReverseEdges(node)) {
+                for (int prevState = graph.getFirstState(edge.sourceIndex);
+                     prevState < graph.getEndState(edge.sourceIndex); prevState++) {
+                    double cost = edge.time;
+                    if (graph.isInterchangeAt(graph.getStateLine(prevState), line)) {
+                        cost += INTERCHANGE_PENALTY_MINUTES;
+                    }
+                    relax(backward, forward, prevState, nodeCost + cost, node);
+                }
             }
         }
     }
     
-    // If we couldn't reach the target
-    if (dist[targetId] == std::numeric_limits<double>::infinity()) {
+    forward.stats.settledNodes += backward.stats.settledNodes;
+    forward.stats.relaxedEdges += backward.stats.relaxedEdges;
+    forward.stats.heapPushes += backward.stats.heapPushes;
+    forward.stats.heapPops += backward.stats.heapPops;
+    
+    if (meetNode < 0) {
         return MetroPath(); // Return empty path
     }
     
-    // Reconstruct the path
-    return reconstructPath(sourceId, targetId, prevStation, prevLine, dist[targetId], useDistance);
+    // Stitch the forward chain (source .. meeting node) to the backward chain (.. target)
+    MetroPath path;
+    for (int node = meetNode; node != -1; node = forward.getPrevNode(node)) {
+        path.stationIds.push_back(lineAware ? graph.getStateStation(node) : node);
+        if (lineAware) {
+            path.lineIds.push_back(graph.getStateLine(node));
+        }
+    }
+    if (lineAware) {
+        path.stationIds.push_back(sourceIndex);
+    }
+    std::reverse(path.stationIds.begin(), path.stationIds.end());
+    std::reverse(path.lineIds.begin(), path.lineIds.end());
+    
+    for (int node = backward.getPrevNode(meetNode); node != -1; node = backward.getPrevNode(node)) {
+        path.stationIds.push_back(lineAware ? graph.getStateStation(node) : node);
+        if (lineAware) {
+            path.lineIds.push_back(graph.getStateLine(node));
+        }
+    }
+    
+    if (!lineAware) {
+        assignShortestLines(path);
+    }
+    
+    finishPath(path, best, useDistance);
+    return path;
 }
 
-MetroPath MetroPathFinder::reconstructPath(
-    int sourceId,
-    int targetId,
-    const std::unordered_map<int, int>& prevStation,
-    const std::unordered_map<int, int>& prevLine,
-    double totalCost,
-    bool useDistance) {
-    
-    MetroPath path;
+void MetroPathFinder::buildContractionHierarchies() {
+    distanceHierarchy.reset(new ContractionHierarchy(graph, true));
+    timeHierarchy.reset(new ContractionHierarchy(graph, false));
+}
+
+MetroPath MetroPathFinder::findPathContracted(int sourceId, int targetId, bool useDistance,
+                                              QueryWorkspace& workspace) {
+    const ContractionHierarchy* hierarchy = useDistance ? distanceHierarchy.get() : timeHierarchy.get();
+    if (!hierarchy) {
+        return findPathDijkstra(sourceId, targetId, useDistance, false, workspace);
+    }
     
-    // Start from target and work backwards
-    int currentId = targetId;
-    std::vector<int> stations;
-    std::vector<int> lines;
+    int sourceIndex = graph.getStationIndex(sourceId);
+    int targetIndex = graph.getStationIndex(targetId);
+    if (sourceIndex < 0 || targetIndex < 0) {
+        return MetroPath();
+    }
     
-    // Build the path in reverse
-    while (currentId != sourceId) {
-        stations.push_back(currentId);
-        
-        // Get the line used to reach this station
-        int lineId = prevLine.at(currentId);
-        lines.push_back(lineId);
-        
-        // Move to previous station
-        currentId = prevStation.at(currentId);
+    MetroPath path;
+    if (sourceIndex == targetIndex) {
+        path.stationIds.push_back(sourceIndex);
+        finishPath(path, 0, useDistance);
+        return path;
     }
     
-    // Add the source station
-    stations.push_back(sourceId);
+    double cost = hierarchy->findPath(sourceIndex, targetIndex, workspace, path);
+    if (cost == std::numeric_limits<double>::infinity()) {
+        return MetroPath(); // Return empty path
+    }
     
-    // Reverse the vectors to get correct order
-    std::reverse(stations.begin(), stations.end());
-    std::reverse(lines.begin(), lines.end());
+    if (useDistance) {
+        assignShortestLines(path);
+    }
+    finishPath(path, cost, useDistance);
+    return path;
+}
+
+MetroPath MetroPathFinder::findPathFromTable(int sourceId, int targetId, bool useDistance,
+                                             QueryWorkspace& workspace) {
+    if (!hasRouteTable()) {
+        return findPathDijkstra(sourceId, targetId, useDistance, false, workspace);
+    }
+    workspace.stats = SearchStats();
     
-    // Set path data
-    path.stationIds = stations;
-    path.lineIds = lines;
+    int sourceIndex = graph.getStationIndex(sourceId);
+    int targetIndex = graph.getStationIndex(targetId);
+    if (sourceIndex < 0 || targetIndex < 0) {
+        return MetroPath();
+    }
     
-    // Calculate total distance and time
-    path.totalDistance = 0;
-    path.totalTime = 0;
-    path.interchangeCount = 0;
+    MetroPath path;
+    path.stationIds.push_back(sourceIndex);
+    if (sourceIndex == targetIndex) {
+        finishPath(path, 0, useDistance);
+        return path;
+    }
     
-    // Count REAL interchanges (line changes between different colored lines)
-    int prevLineId = -1;
-    for (size_t i = 0; i < lines.size(); i++) {
-        int lineId = lines[i];
-        if (prevLineId != -1 && isRealInterchange(graph, prevLineId, lineId)) {
-            path.interchangeCount++;
-        }
-        prevLineId = lineId;
+    int firstHop = routeTable->getEntry(useDistance, sourceIndex, targetIndex).nextHop;
+    if (firstHop == RouteTable::NO_HOP) {
+        return MetroPath(); // Return empty path
     }
     
-    // Set the total cost based on what we optimized for
     if (useDistance) {
-        path.totalDistance = totalCost;
-        
-        // Calculate time
-        for (size_t i = 0; i < stations.size() - 1; i++) {
-            for (const auto& edge : graph.getNeighbors(stations[i])) {
-                if (edge.targetId == stations[i + 1] && edge.lineId == lines[i]) {
-                    path.totalTime += edge.time;
-                    break;
-                }
+        // Each station's next hop towards the target continues the same shortest route
+        for (int station = firstHop; ; station = routeTable->getEntry(true, station, targetIndex).nextHop) {
+            path.stationIds.push_back(station);
+            if (station == targetIndex) {
+                break;
             }
         }
+        finishPath(path, assignShortestLines(path), true);
+        return path;
+    }
+    
+    // Time routes continue from the state a station was reached in; re-add the
+    // ride and interchange costs so the total matches the searches exactly
+    double totalTime = 0;
+    int prevLine = -1;
+    for (int state = firstHop; state != RouteTable::NO_HOP; state = routeTable->getNextState(state, targetIndex)) {
+        int station = graph.getStateStation(state);
+        int line = graph.getStateLine(state);
         
-        // Add 8 minutes for each REAL interchange
-        path.totalTime += path.interchangeCount * 8.0;
-    } else {
-        // When optimizing for time, totalCost already includes the interchange penalties
-        path.totalTime = totalCost;
-        
-        // Calculate distance
-        for (size_t i = 0; i < stations.size() - 1; i++) {
-            for (const auto& edge : graph.getNeighbors(stations[i])) {
-                if (edge.targetId == stations[i + 1] && edge.lineId == lines[i]) {
-                    path.totalDistance += edge.distance;
-                    break;
-                }
+        double rideTime = std::numeric_limits<double>::infinity();
+        for (const CsrEdge& edge : graph.getEdges(path.stationIds.back())) {
+            if (edge.targetIndex == station && edge.lineIndex == line) {
+                rideTime = std::min(rideTime, edge.time);
             }
         }
+        totalTime += rideTime;
+        if (prevLine != -1 && graph.isInterchangeAt(prevLine, line)) {
+            totalTime += INTERCHANGE_PENALTY_MINUTES;
+        }
+        
+        path.stationIds.push_back(station);
+        path.lineIds.push_back(line);
+        prevLine = line;
     }
-    
+    finishPath(path, totalTime, false);
     return path;
 }
 
+MetroPath MetroPathFinder::findPath(int sourceId, int targetId, bool useDistance, QueryWorkspace& workspace) {
+    // The other algorithms precompute over the network as parsed, so disruptions bypass them
+    if (!overlay.isEmpty() && algorithm != SearchAlgorithm::AStar) {
+        return findPathDijkstra(sourceId, targetId, useDistance, false, workspace);
+    }
+    
+    switch (algorithm) {
+        case SearchAlgorithm::AStar:
+            return findPathDijkstra(sourceId, targetId, useDistance, true, workspace);
+        case SearchAlgorithm::Bidirectional:
+            return findPathBidirectional(sourceId, targetId, useDistance, workspace);
+        case SearchAlgorithm::ContractionHierarchy:
+            return findPathContracted(sourceId, targetId, useDistance, workspace);
+        case SearchAlgorithm::RouteTable:
+            return findPathFromTable(sourceId, targetId, useDistance, workspace);
+        case SearchAlgorithm::Dijkstra:
+        default:
+            return findPathDijkstra(sourceId, targetId, useDistance, false, workspace);
+    }
+}
+
 MetroPath MetroPathFinder::findShortestPath(int sourceId, int targetId) {
-    return findPathDijkstra(sourceId, targetId, true);
+    return findShortestPath(sourceId, targetId, threadWorkspace());
 }
 
 MetroPath MetroPathFinder::findFastestPath(int sourceId, int targetId) {
-    return findPathDijkstra(sourceId, targetId, false);
+    return findFastestPath(sourceId, targetId, threadWorkspace());
 }
 
-MetroPath MetroPathFinder::findShortestPath(const std::string& sourceName, const std::string& targetName) {
-    auto sourceStations = graph.getStationsByName(sourceName);
-    auto targetStations = graph.getStationsByName(targetName);
+MetroPath MetroPathFinder::findShortestPath(int sourceId, int targetId, QueryWorkspace& workspace) {
+    return findPath(sourceId, targetId, true, workspace);
+}
+
+MetroPath MetroPathFinder::findFastestPath(int sourceId, int targetId, QueryWorkspace& workspace) {
+    return findPath(sourceId, targetId, false, workspace);
+}
+
+StationTimes MetroPathFinder::findFastestTimes(int sourceId, double maxTime) {
+    return findFastestTimes(sourceId, maxTime, threadWorkspace());
+}
+
+StationTimes MetroPathFinder::findFastestTimes(int sourceId, double maxTime, QueryWorkspace& workspace) {
+    StationTimes result;
+    int sourceIndex = graph.isFrozen() ? graph.getStationIndex(sourceId) : -1;
+    if (sourceIndex < 0 || maxTime < 0) {
+        return result;
+    }
     
-    if (sourceStations.empty() || targetStations.empty()) {
-        return MetroPath(); // Return empty path if stations not found
+    // Nodes are line-aware states so the interchange penalty is exact; the prevLine
+    // slot holds the edge each state was reached by. The secondary cost of a settled
+    // state is its distance along the fastest path
+    workspace.begin(static_cast<size_t>(graph.getStateCount()));
+    workspace.beginStationMarks(static_cast<size_t>(graph.getStationCount()));
+    std::vector<DijkstraNode>& heap = workspace.heap;
+    std::greater<> heapCompare;
+    
+    result.stationIds.push_back(sourceId);
+    result.times.push_back(0);
+    result.distances.push_back(0);
+    workspace.markStation(sourceIndex);
+    
+    auto relax = [&](int station, int line, double time, int fromState) {
+        for (const CsrEdge& edge : graph.getEdges(station)) {
+            double newTime = time + edge.time;
+            
+            // Add interchange penalty only for REAL interchanges
+            if (line >= 0 && graph.isInterchangeAt(line, edge.lineIndex)) {
+                newTime += INTERCHANGE_PENALTY_MINUTES;
+            }
+            
+            workspace.stats.relaxedEdges++;
+            int edgeIndex = graph.getEdgeIndex(edge);
+            int state = graph.getEdgeTargetState(edgeIndex);
+            if (newTime <= maxTime && workspace.getDist(state) > newTime) {
+                workspace.setDist(state, newTime, fromState, edgeIndex);
+                heap.push_back(DijkstraNode(state, newTime, fromState, edge.lineIndex));
+                std::push_heap(heap.begin(), heap.end(), heapCompare);
+                workspace.stats.heapPushes++;
+            }
+        }
+    };
+    
+    // Nothing over the budget is ever pushed, so the search ends at the isochrone
+    relax(sourceIndex, -1, 0, -1);
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), heapCompare);
+        int state = heap.back().stationId;
+        heap.pop_back();
+        workspace.stats.heapPops++;
+        if (workspace.isSettled(state)) {
+            continue;
+        }
+        workspace.markSettled(state);
+        workspace.stats.settledNodes++;
+        
+        int prevState = workspace.getPrevNode(state);
+        double distance = (prevState >= 0 ? workspace.getSecondaryCost(prevState) : 0) +
+                          graph.getEdgeAt(workspace.getPrevLine(state)).distance;
+        workspace.setSecondaryCost(state, distance);
+        
+        // The first state settled at a station carries its fastest time
+        int station = graph.getStateStation(state);
+        if (!workspace.isStationMarked(station)) {
+            workspace.markStation(station);
+            result.stationIds.push_back(graph.getStationIdAt(station));
+            result.times.push_back(workspace.getDist(state));
+            result.distances.push_back(distance);
+        }
+        relax(station, graph.getStateLine(state), workspace.getDist(state), state);
     }
     
-    // Use first matching station for simplicity
-    // In a real app, you might want to ask user to choose if multiple matches
-    return findShortestPath(sourceStations[0]->id, targetStations[0]->id);
+    return result;
 }
 
-MetroPath MetroPathFinder::findFastestPath(const std::string& sourceName, const std::string& targetName) {
-    auto sourceStations = graph.getStationsByName(sourceName);
-    auto targetStations = graph.getStationsByName(targetName);
+void MetroPathFinder::searchToTargets(int sourceIndex, bool useDistance, std::vector<char>& pendingTargets,
+                                      int targetCount, QueryWorkspace& workspace) const {
+    // Distance needs no line context, so it runs over stations; time runs over
+    // line-aware states so the interchange penalty is exact
+    size_t nodeCount = static_cast<size_t>(useDistance ? graph.getStationCount() : graph.getStateCount());
+    workspace.begin(nodeCount);
+    std::vector<DijkstraNode>& heap = workspace.heap;
+    std::greater<> heapCompare;
+    
+    auto relax = [&](int station, int line, double cost, int fromNode) {
+        for (const CsrEdge& edge : graph.getEdges(station)) {
+            double newCost = cost + (useDistance ? edge.distance : edge.time);
+            if (!useDistance && line >= 0 && graph.isInterchangeAt(line, edge.lineIndex)) {
+                newCost += INTERCHANGE_PENALTY_MINUTES;
+            }
+            
+            workspace.stats.relaxedEdges++;
+            int node = useDistance ? edge.targetIndex : graph.getEdgeTargetState(graph.getEdgeIndex(edge));
+            if (workspace.getDist(node) > newCost) {
+                workspace.setDist(node, newCost, fromNode, edge.lineIndex);
+                heap.push_back(DijkstraNode(node, newCost, fromNode, edge.lineIndex));
+                std::push_heap(heap.begin(), heap.end(), heapCompare);
+                workspace.stats.heapPushes++;
+            }
+        }
+    };
+    
+    // The source itself counts as settled; in time mode it has no state of its own
+    int remaining = targetCount;
+    if (pendingTargets[sourceIndex]) {
+        pendingTargets[sourceIndex] = 0;
+        remaining--;
+    }
+    if (useDistance) {
+        workspace.setDist(sourceIndex, 0, -1, -1);
+        heap.push_back(DijkstraNode(sourceIndex, 0, -1, -1));
+    } else {
+        relax(sourceIndex, -1, 0, -1);
+    }
+    
+    // A station is final once its first node is settled; stop when all targets are
+    while (!heap.empty() && remaining > 0) {
+        std::pop_heap(heap.begin(), heap.end(), heapCompare);
+        int node = heap.back().stationId;
+        heap.pop_back();
+        workspace.stats.heapPops++;
+        if (workspace.isSettled(node)) {
+            continue;
+        }
+        workspace.markSettled(node);
+        workspace.stats.settledNodes++;
+        
+        int station = useDistance ? node : graph.getStateStation(node);
+        if (pendingTargets[station]) {
+            pendingTargets[station] = 0;
+            remaining--;
+        }
+        relax(station, useDistance ? -1 : graph.getStateLine(node), workspace.getDist(node), node);
+    }
+}
+
+double MetroPathFinder::getStationCost(int stationIndex, bool useDistance, const QueryWorkspace& workspace) const {
+    if (useDistance) {
+        return workspace.getDist(stationIndex);
+    }
+    double best = std::numeric_limits<double>::infinity();
+    for (int state = graph.getFirstState(stationIndex); state < graph.getEndState(stationIndex); state++) {
+        best = std::min(best, workspace.getDist(state));
+    }
+    return best;
+}
+
+void MetroPathFinder::computeMatrix(const std::vector<int>& sourceIds, const std::vector<int>& targetIds,
+                                    bool useDistance, float* out, unsigned threadCount) const {
+    const float infinity = std::numeric_limits<float>::infinity();
+    std::fill(out, out + sourceIds.size() * targetIds.size(), infinity);
+    if (!graph.isFrozen() || sourceIds.empty() || targetIds.empty()) {
+        return;
+    }
+    
+    // Dense indices of the targets, shared read-only by the workers
+    std::vector<int> targetIndices(targetIds.size());
+    std::vector<char> isTarget(graph.getStationCount(), 0);
+    int targetCount = 0;
+    for (size_t i = 0; i < targetIds.size(); i++) {
+        targetIndices[i] = graph.getStationIndex(targetIds[i]);
+        if (targetIndices[i] >= 0 && !isTarget[targetIndices[i]]) {
+            isTarget[targetIndices[i]] = 1;
+            targetCount++;
+        }
+    }
     
-    if (sourceStations.empty() || targetStations.empty()) {
+    // A search takes tens of microseconds, so a few rows aren't worth waking a worker
+    // for; small matrices stay on the calling thread
+    TaskPool& pool = TaskPool::shared();
+    if (threadCount == 0) {
+        threadCount = pool.getWorkerCount() + 1;
+    }
+    threadCount = static_cast<unsigned>(std::min<size_t>(
+        threadCount, (sourceIds.size() + MIN_MATRIX_ROWS_PER_THREAD - 1) / MIN_MATRIX_ROWS_PER_THREAD));
+    
+    // Each source is one row of the matrix, so threads never write the same entry
+    std::atomic<int> nextSource(0);
+    auto work = [&](size_t /*task*/) {
+        QueryWorkspace& workspace = threadWorkspace();
+        std::vector<char> pendingTargets;
+        for (int row = nextSource++; row < static_cast<int>(sourceIds.size()); row = nextSource++) {
+            int sourceIndex = graph.getStationIndex(sourceIds[row]);
+            if (sourceIndex < 0) {
+                continue;
+            }
+            pendingTargets = isTarget;
+            searchToTargets(sourceIndex, useDistance, pendingTargets, targetCount, workspace);
+            
+            float* rowOut = out + static_cast<size_t>(row) * targetIds.size();
+            for (size_t column = 0; column < targetIndices.size(); column++) {
+                int targetIndex = targetIndices[column];
+                if (targetIndex == sourceIndex) {
+                    rowOut[column] = 0;
+                } else if (targetIndex >= 0) {
+                    rowOut[column] = static_cast<float>(getStationCost(targetIndex, useDistance, workspace));
+                }
+            }
+        }
+    };
+    
+    pool.run(threadCount, work, threadCount);
+}
+
+std::vector<int> MetroPathFinder::findStationIndices(const std::string& name) const {
+    std::vector<int> indices;
+    for (const MetroStation* station : graph.getStationsByName(name)) {
+        int index = graph.getStationIndex(station->id);
+        if (index >= 0) {
+            indices.push_back(index);
+        }
+    }
+    
+    // Hash-map order isn't stable; keep ties between candidates deterministic
+    std::sort(indices.begin(), indices.end());
+    return indices;
+}
+
+MetroPath MetroPathFinder::findPathByNames(const std::string& sourceName, const std::string& targetName,
+                                           bool useDistance) {
+    std::vector<int> sourceIndices = findStationIndices(sourceName);
+    std::vector<int> targetIndices = findStationIndices(targetName);
+    
+    if (sourceIndices.empty() || targetIndices.empty()) {
         return MetroPath(); // Return empty path if stations not found
     }
     
-    // Use first matching station for simplicity
-    return findFastestPath(sourceStations[0]->id, targetStations[0]->id);
-} 
\ No newline at end of file
+    // An unambiguous pair can use any algorithm
+    if (sourceIndices.size() == 1 && targetIndices.size() == 1) {
+        return findPath(graph.getStationIdAt(sourceIndices[0]), graph.getStationIdAt(targetIndices[0]),
+                        useDistance, threadWorkspace());
+    }
+    
+    // Otherwise one search seeded with every candidate source, ending at the nearest candidate target
+    return findPathDijkstra(CsrRange<int>{sourceIndices.data(), sourceIndices.data() + sourceIndices.size()},
+                            CsrRange<int>{targetIndices.data(), targetIndices.data() + targetIndices.size()},
+                            useDistance, algorithm == SearchAlgorithm::AStar, threadWorkspace());
+}
+
+MetroPath MetroPathFinder::findShortestPath(const std::string& sourceName, const std::string& targetName) {
+    return findPathByNames(sourceName, targetName, true);
+}
+
+MetroPath MetroPathFinder::findFastestPath(const std::string& sourceName, const std::string& targetName) {
+    return findPathByNames(sourceName, targetName, false);
+}
@@ -1,48 +1,183 @@
 #ifndef METRO_PATH_FINDER_H
 #define METRO_PATH_FINDER_H
 
+#include "contraction_hierarchy.h"
+#include "cost_policy.h"
+#include "line_graph.h"
+#include "network_overlay.h"
 #include "metro_graph.h"
+#include "query_workspace.h"
+#include "route_table.h"
+#include <memory>
 #include <queue>
 #include <limits>
+#include <stdexcept>
 #include <unordered_set>
 
+// Search algorithm used for point-to-point queries
+enum class SearchAlgorithm {
+    Dijkstra = 0,               // Plain Dijkstra from the source
+    AStar = 1,                  // Dijkstra guided by a straight-line lower bound to the target
+    Bidirectional = 2,          // Forward and backward Dijkstra meeting in the middle
+    ContractionHierarchy = 3,   // Upward searches in a precomputed hierarchy (see buildContractionHierarchies)
+    RouteTable = 4              // Next-hop lookups in a precomputed all-pairs table (see setRouteTable)
+};
+
+// Priority queue of the Dijkstra and A* searches, fixed at compile time: a binary
+// heap unless METRO_BUCKET_QUEUE is defined. Both give the same paths; on the Delhi
+// feed the queue sees about one push per thousand relaxed edges, so neither is faster.
+#ifdef METRO_BUCKET_QUEUE
+using DijkstraQueue = BucketQueue;
+#else
+using DijkstraQueue = BinaryHeapQueue;
+#endif
+
+// Stations reached by a one-to-all search, ordered by travel time
+struct StationTimes {
+    std::vector<int> stationIds;
+    std::vector<double> times;      // Minutes, including interchange penalties
+    std::vector<double> distances;  // Km along each fastest path
+};
+
 // Path finder class to find shortest and fastest paths in the metro network
 class MetroPathFinder {
 private:
     const MetroGraph& graph;
     
-    // Helper struct for Dijkstra's algorithm
-    struct DijkstraNode {
-        int stationId;
-        double cost;
-        int prevStationId;
-        int lineId;
-        
-        // Constructor
-        DijkstraNode(int id, double c, int prev, int line) 
-            : stationId(id), cost(c), prevStationId(prev), lineId(line) {}
-        
-        // Comparison operator for priority queue
-        bool operator>(const DijkstraNode& other) const {
-            return cost > other.cost;
-        }
-    };
+    // (station, line) expansion of the graph, built with the finder
+    LineGraph lineGraph;
+    
+    // Closures and slowdowns applied on top of the graph
+    NetworkOverlay overlay;
+    
+    SearchAlgorithm algorithm = SearchAlgorithm::Dijkstra;
+    
+    // Hierarchies for the two metrics, null until buildContractionHierarchies()
+    std::unique_ptr<ContractionHierarchy> distanceHierarchy;
+    std::unique_ptr<ContractionHierarchy> timeHierarchy;
+    
+    // All-pairs table, null until setRouteTable()
+    std::unique_ptr<RouteTable> routeTable;
+    
+    // Bucket widths of BucketQueue for the two metrics
+    double distanceResolution = 0.1;    // km
+    double timeResolution = 1.0;        // minutes
+    
+    // Internal function to find path using Dijkstra's algorithm, or A* when useAStar is set,
+    // over stations; Queue is BinaryHeapQueue or BucketQueue, Policy a cost policy that
+    // doesn't charge interchanges. The search starts from all sources at once (a virtual
+    // super-source) and ends at the first target settled, so the path runs between the
+    // best pair; sources and targets are dense station indices. UseOverlay compiles in
+    // the overlay checks, for queries made while the overlay isn't empty.
+    template <typename Queue, bool UseOverlay, typename Policy>
+    MetroPath findPathDijkstra(CsrRange<int> sources, CsrRange<int> targets, const Policy& policy,
+                               bool useAStar, QueryWorkspace& workspace);
+    
+    // The same search over the line graph, for policies that charge interchanges: the
+    // policy's interchange cost is the weight of the transfer edges
+    template <typename Queue, bool UseOverlay, typename Policy>
+    MetroPath findPathOnLines(CsrRange<int> sources, CsrRange<int> targets, const Policy& policy,
+                              bool useAStar, QueryWorkspace& workspace);
+    
+    // Pick the kernel for the metric, once per query
+    MetroPath findPathDijkstra(CsrRange<int> sources, CsrRange<int> targets, bool useDistance, bool useAStar,
+                               QueryWorkspace& workspace);
+    MetroPath findPathDijkstra(int sourceId, int targetId, bool useDistance, bool useAStar,
+                               QueryWorkspace& workspace);
+    
+    // Bidirectional Dijkstra; time queries run over (station, arriving line) states so the
+    // interchange penalty is exact in both directions, the backward half uses the reverse CSR
+    MetroPath findPathBidirectional(int sourceId, int targetId, bool useDistance, QueryWorkspace& workspace);
+    
+    // Query the hierarchy for the metric; falls back to Dijkstra if it hasn't been built
+    MetroPath findPathContracted(int sourceId, int targetId, bool useDistance, QueryWorkspace& workspace);
+    
+    // Follow next hops in the route table; falls back to Dijkstra if there is none
+    MetroPath findPathFromTable(int sourceId, int targetId, bool useDistance, QueryWorkspace& workspace);
+    
+    // Helper function to reconstruct path from the predecessors left in the workspace,
+    // as dense station/line indices, back to the source it started from
+    MetroPath reconstructPath(int targetIndex, const QueryWorkspace& workspace) const;
     
-    // Internal function to find path using Dijkstra's algorithm
-    MetroPath findPathDijkstra(int sourceId, int targetId, bool useDistance);
+    // Lower bound on the straight-line distance from a station to the nearest target
+    double getTargetDistance(int index, CsrRange<int> targets) const;
     
-    // Helper function to reconstruct path from Dijkstra results
-    MetroPath reconstructPath(
-        int sourceId,
-        int targetId,
-        const std::unordered_map<int, int>& prevStation,
-        const std::unordered_map<int, int>& prevLine,
-        double totalCost,
-        bool useDistance);
+    // Dense indices of the stations whose names contain a name
+    std::vector<int> findStationIndices(const std::string& name) const;
+    
+    // One search between all stations matching two names
+    MetroPath findPathByNames(const std::string& sourceName, const std::string& targetName, bool useDistance);
+    
+    // Pick each hop's line of a distance path the way the forward search does: the
+    // first parallel edge giving the lowest running total, in adjacency order;
+    // returns the total distance
+    double assignShortestLines(MetroPath& path) const;
+    
+    // Fill interchanges and totals of a path holding dense station/line indices,
+    // then map it back to stop_ids and line IDs
+    void finishPath(MetroPath& path, double totalCost, bool useDistance) const;
+    
+    // Overlay time factor of a hop taken on an edge (1 without disruptions)
+    double getTimeFactor(int fromIndex, const CsrEdge& edge) const;
+    
+    // Time of a path holding dense indices as the time search costs it, for paths
+    // found under PathCost::Other
+    double sumPathTime(const MetroPath& path) const;
+    
+    // Dispatch one query to the selected algorithm
+    MetroPath findPath(int sourceId, int targetId, bool useDistance, QueryWorkspace& workspace);
+    
+    // One search from a source that stops once the targetCount stations flagged in
+    // pendingTargets are settled, clearing their flags as it goes; afterwards the cost
+    // of a target is getStationCost(station, ...)
+    void searchToTargets(int sourceIndex, bool useDistance, std::vector<char>& pendingTargets,
+                         int targetCount, QueryWorkspace& workspace) const;
+    
+    // Cost of a station after searchToTargets: its node in distance mode, its best
+    // line-aware state in time mode
+    double getStationCost(int stationIndex, bool useDistance, const QueryWorkspace& workspace) const;
+    
+    // Workspace owned by the calling thread, used by the overloads that don't take one
+    static QueryWorkspace& threadWorkspace();
 
 public:
-    // Constructor
-    explicit MetroPathFinder(const MetroGraph& metroGraph) : graph(metroGraph) {}
+    // Constructor; expands the graph by line, so the graph must be frozen first
+    explicit MetroPathFinder(const MetroGraph& metroGraph)
+        : graph(metroGraph), lineGraph(metroGraph), overlay(metroGraph) {}
+    
+    // Select the algorithm used by the find* methods
+    void setSearchAlgorithm(SearchAlgorithm newAlgorithm) { algorithm = newAlgorithm; }
+    SearchAlgorithm getSearchAlgorithm() const { return algorithm; }
+    
+    // Disruptions consulted by the point-to-point queries. While the overlay isn't
+    // empty, the bidirectional, contraction hierarchy and route table algorithms
+    // answer with Dijkstra instead, as their precomputation assumes the parsed network;
+    // travel times, matrices and the other routers ignore it. Change it between queries.
+    NetworkOverlay& getOverlay() { return overlay; }
+    const NetworkOverlay& getOverlay() const { return overlay; }
+    
+    // Quantize queue keys of the Dijkstra and A* searches to these bucket widths; any
+    // positive width gives exact results, it only trades bucket count for bucket size.
+    // Widths that aren't positive are rejected with std::invalid_argument.
+    void setQueueResolution(double distanceKm, double timeMinutes) {
+        if (!(distanceKm > 0) || !(timeMinutes > 0)) {
+            throw std::invalid_argument("Queue resolutions must be positive");
+        }
+        distanceResolution = distanceKm;
+        timeResolution = timeMinutes;
+    }
+    
+    // Preprocess the frozen graph for SearchAlgorithm::ContractionHierarchy (both metrics);
+    // call once after parsing, before queries start
+    void buildContractionHierarchies();
+    bool hasContractionHierarchies() const { return distanceHierarchy && timeHierarchy; }
+    
+    // Use a loaded all-pairs table for SearchAlgorithm::RouteTable
+    void setRouteTable(std::unique_ptr<RouteTable> table) { routeTable = std::move(table); }
+    bool hasRouteTable() const { return routeTable && routeTable->isLoaded(); }
+    
+    // Counters of the last query made on the calling thread's default workspace
+    static const SearchStats& getLastSearchStats() { return threadWorkspace().stats; }
     
     // Find shortest path by distance
     MetroPath findShortestPath(int sourceId, int targetId);
@@ -50,11 +185,271 @@ public:
     // Find fastest path by time
     MetroPath findFastestPath(int sourceId, int targetId);
     
-    // Find shortest path by station names
+    // Same queries using a caller-owned workspace (one per thread; reused across queries)
+    MetroPath findShortestPath(int sourceId, int targetId, QueryWorkspace& workspace);
+    MetroPath findFastestPath(int sourceId, int targetId, QueryWorkspace& workspace);
+    
+    // Dijkstra (or A* when the selected algorithm is AStar) under any cost policy; the
+    // other algorithms precompute for distance and time only, so they aren't used here
+    template <typename Policy>
+    MetroPath findPathWithCost(int sourceId, int targetId, const Policy& policy) {
+        int sourceIndex = graph.getStationIndex(sourceId);
+        int targetIndex = graph.getStationIndex(targetId);
+        if (sourceIndex < 0 || targetIndex < 0) {
+            return MetroPath();
+        }
+        CsrRange<int> sources{&sourceIndex, &sourceIndex + 1};
+        CsrRange<int> targets{&targetIndex, &targetIndex + 1};
+        bool useAStar = algorithm == SearchAlgorithm::AStar;
+        QueryWorkspace& workspace = threadWorkspace();
+        if constexpr (Policy::chargesInterchanges) {
+            return overlay.isEmpty() ?
+                findPathOnLines<DijkstraQueue, false>(sources, targets, policy, useAStar, workspace) :
+                findPathOnLines<DijkstraQueue, true>(sources, targets, policy, useAStar, workspace);
+        } else {
+            return overlay.isEmpty() ?
+                findPathDijkstra<DijkstraQueue, false>(sources, targets, policy, useAStar, workspace) :
+                findPathDijkstra<DijkstraQueue, true>(sources, targets, policy, useAStar, workspace);
+        }
+    }
+    
+    // Fastest times from one station to every station reachable within maxTime minutes,
+    // in one search over line-aware states that stops once the budget is exceeded
+    StationTimes findFastestTimes(int sourceId, double maxTime = std::numeric_limits<double>::infinity());
+    StationTimes findFastestTimes(int sourceId, double maxTime, QueryWorkspace& workspace);
+    
+    // Costs from every source to every target (distance in km, or exact time in minutes
+    // with interchange penalties) written row-major into out, sized sources x targets.
+    // One one-to-many search per source, spread over up to threadCount threads of the
+    // shared TaskPool (0 = all of them), with at least MIN_MATRIX_ROWS_PER_THREAD rows
+    // per thread. Unknown stations and unreachable pairs are infinity.
+    void computeMatrix(const std::vector<int>& sourceIds, const std::vector<int>& targetIds, bool useDistance,
+                       float* out, unsigned threadCount = 0) const;
+    static constexpr size_t MIN_MATRIX_ROWS_PER_THREAD = 8;
+    
+    // Find shortest path by station names. Every station whose name contains a name
+    // is a candidate and one search finds the best pair; the chosen stop_ids are the
+    // first and last stationIds of the path. A single candidate on each side uses
+    // the selected algorithm, several use Dijkstra (A* if selected).
     MetroPath findShortestPath(const std::string& sourceName, const std::string& targetName);
     
-    // Find fastest path by station names
+    // Find fastest path by station names, choosing among candidates the same way
     MetroPath findFastestPath(const std::string& sourceName, const std::string& targetName);
 };
 
+template <typename Queue, bool UseOverlay, typename Policy>
+MetroPath MetroPathFinder::findPathDijkstra(CsrRange<int> sources, CsrRange<int> targets, const Policy& policy,
+                                            bool useAStar, QueryWorkspace& workspace) {
+    static_assert(!Policy::chargesInterchanges, "interchange costs need findPathOnLines");
+    
+    // Queries run on the frozen CSR layout only
+    if (!graph.isFrozen() || sources.empty() || targets.empty()) {
+        return MetroPath();
+    }
+    
+    // O(1) reset of the distance/predecessor arrays, then the queue over the workspace storage
+    workspace.begin(static_cast<size_t>(graph.getStationCount()));
+    Queue queue(workspace, Policy::metric == PathCost::Distance ? distanceResolution : timeResolution);
+    
+    // A* lower bound on the remaining cost: straight-line distance to the nearest
+    // target at the policy's cheapest cost per km. It is consistent, so each station
+    // is still settled once; the small scale-down keeps rounding in the haversine sums
+    // from breaking that.
+    double heuristicScale = useAStar ? (1.0 - 1e-9) * policy.costPerKm(graph) : 0;
+    if (UseOverlay && Policy::metric != PathCost::Distance) {
+        heuristicScale *= overlay.getMinTimeScale();
+    }
+    auto heuristic = [&](int index) {
+        return heuristicScale > 0 ? heuristicScale * getTargetDistance(index, targets) : 0.0;
+    };
+    
+    // Distance from each source to itself is 0
+    for (int sourceIndex : sources) {
+        if (UseOverlay && !overlay.isStationOpen(sourceIndex)) {
+            continue;
+        }
+        workspace.setDist(sourceIndex, 0, -1, -1);
+        
+        // Push source node to the queue (keyed by distance plus lower bound)
+        queue.push(DijkstraNode(sourceIndex, heuristic(sourceIndex), -1, -1));
+    }
+    
+    // Process nodes in queue order
+    int targetIndex = -1;
+    while (!queue.empty()) {
+        DijkstraNode current = queue.pop();
+        
+        int currentIndex = current.stationId;
+        
+        // If we've reached a target, we can stop
+        if (std::find(targets.begin(), targets.end(), currentIndex) != targets.end()) {
+            workspace.stats.settledNodes++;
+            targetIndex = currentIndex;
+            break;
+        }
+        
+        // Skip if already processed
+        if (workspace.isSettled(currentIndex)) {
+            continue;
+        }
+        
+        workspace.markSettled(currentIndex);
+        workspace.stats.settledNodes++;
+        double currentDist = workspace.getDist(currentIndex);
+        
+        // Process all neighbors
+        for (const CsrEdge& edge : graph.getEdges(currentIndex)) {
+            int neighborIndex = edge.targetIndex;
+            double cost = policy.edgeCost(edge);
+            
+            // Skip closed hops; slowdowns stretch every cost but distance
+            if (UseOverlay) {
+                double factor = overlay.getEdgeFactor(currentIndex, neighborIndex, edge.lineIndex);
+                if (factor == std::numeric_limits<double>::infinity()) {
+                    continue;
+                }
+                if (Policy::metric != PathCost::Distance) {
+                    cost *= factor;
+                }
+            }
+            
+            // If we found a shorter path
+            double newDist = currentDist + cost;
+            workspace.stats.relaxedEdges++;
+            if (workspace.getDist(neighborIndex) > newDist) {
+                workspace.setDist(neighborIndex, newDist, currentIndex, edge.lineIndex);
+                
+                // Add to queue
+                queue.push(DijkstraNode(neighborIndex, newDist + heuristic(neighborIndex),
+                                        currentIndex, edge.lineIndex));
+            }
+        }
+    }
+    
+    // If we couldn't reach a target
+    if (targetIndex < 0) {
+        return MetroPath(); // Return empty path
+    }
+    
+    // Reconstruct the path; a cost that is neither distance nor time is reported as time
+    double targetDist = workspace.getDist(targetIndex);
+    MetroPath path = reconstructPath(targetIndex, workspace);
+    if (Policy::metric == PathCost::Other) {
+        targetDist = sumPathTime(path);
+    }
+    finishPath(path, targetDist, Policy::metric == PathCost::Distance);
+    return path;
+}
+
+template <typename Queue, bool UseOverlay, typename Policy>
+MetroPath MetroPathFinder::findPathOnLines(CsrRange<int> sources, CsrRange<int> targets, const Policy& policy,
+                                           bool useAStar, QueryWorkspace& workspace) {
+    if (!graph.isFrozen() || lineGraph.getNodeCount() == 0 || sources.empty() || targets.empty()) {
+        return MetroPath();
+    }
+    auto isTarget = [&](int index) {
+        return std::find(targets.begin(), targets.end(), index) != targets.end();
+    };
+    for (int sourceIndex : sources) {
+        if (isTarget(sourceIndex) && (!UseOverlay || overlay.isStationOpen(sourceIndex))) {
+            MetroPath path;
+            path.stationIds.push_back(sourceIndex);
+            finishPath(path, 0, Policy::metric == PathCost::Distance);
+            return path;
+        }
+    }
+    
+    workspace.begin(static_cast<size_t>(lineGraph.getNodeCount()));
+    Queue queue(workspace, Policy::metric == PathCost::Distance ? distanceResolution : timeResolution);
+    
+    // Same lower bound as the station search; transfers cover no distance, so it stays consistent
+    double heuristicScale = useAStar ? (1.0 - 1e-9) * policy.costPerKm(graph) : 0;
+    if (UseOverlay && Policy::metric != PathCost::Distance) {
+        heuristicScale *= overlay.getMinTimeScale();
+    }
+    auto heuristic = [&](int node) {
+        return heuristicScale > 0 ?
+            heuristicScale * getTargetDistance(lineGraph.getNodeStation(node), targets) : 0.0;
+    };
+    auto relax = [&](int node, int next, double newCost) {
+        workspace.stats.relaxedEdges++;
+        if (workspace.getDist(next) > newCost) {
+            workspace.setDist(next, newCost, node, lineGraph.getNodeLine(next));
+            queue.push(DijkstraNode(next, newCost + heuristic(next), node, -1));
+        }
+    };
+    
+    // Boarding the first train is free on every line at every source
+    for (int sourceIndex : sources) {
+        if (UseOverlay && !overlay.isStationOpen(sourceIndex)) {
+            continue;
+        }
+        for (int node = lineGraph.getFirstNode(sourceIndex); node < lineGraph.getEndNode(sourceIndex); node++) {
+            workspace.setDist(node, 0, -1, -1);
+            queue.push(DijkstraNode(node, heuristic(node), -1, -1));
+        }
+    }
+    
+    int targetNode = -1;
+    while (!queue.empty()) {
+        int node = queue.pop().stationId;
+        if (workspace.isSettled(node)) {
+            continue;
+        }
+        workspace.markSettled(node);
+        workspace.stats.settledNodes++;
+        if (isTarget(lineGraph.getNodeStation(node))) {
+            targetNode = node;
+            break;
+        }
+        
+        double cost = workspace.getDist(node);
+        for (const CsrEdge& ride : lineGraph.getRides(node)) {
+            if (UseOverlay) {
+                // Closed hops and lines are skipped; slowdowns stretch every cost but distance
+                double factor = overlay.getEdgeFactor(lineGraph.getNodeStation(node),
+                                                      lineGraph.getNodeStation(ride.targetIndex), ride.lineIndex);
+                if (factor == std::numeric_limits<double>::infinity()) {
+                    continue;
+                }
+                relax(node, ride.targetIndex,
+                      cost + policy.edgeCost(ride) * (Policy::metric == PathCost::Distance ? 1.0 : factor));
+            } else {
+                relax(node, ride.targetIndex, cost + policy.edgeCost(ride));
+            }
+        }
+        for (int next : lineGraph.getTransfers(node)) {
+            if (UseOverlay && !overlay.isLineOpen(lineGraph.getNodeLine(next))) {
+                continue;
+            }
+            relax(node, next, cost + policy.interchangeCost());
+        }
+    }
+    if (targetNode < 0) {
+        return MetroPath(); // Return empty path
+    }
+    
+    // Walk back to the source, keeping the rides and skipping the transfers
+    MetroPath path;
+    for (int node = targetNode; node >= 0; ) {
+        int prev = workspace.getPrevNode(node);
+        if (prev < 0 || lineGraph.getNodeStation(prev) != lineGraph.getNodeStation(node)) {
+            path.stationIds.push_back(lineGraph.getNodeStation(node));
+            if (prev >= 0) {
+                path.lineIds.push_back(lineGraph.getNodeLine(node));
+            }
+        }
+        node = prev;
+    }
+    std::reverse(path.stationIds.begin(), path.stationIds.end());
+    std::reverse(path.lineIds.begin(), path.lineIds.end());
+    
+    double totalCost = workspace.getDist(targetNode);
+    if (Policy::metric == PathCost::Other) {
+        totalCost = sumPathTime(path);
+    }
+    finishPath(path, totalCost, Policy::metric == PathCost::Distance);
+    return path;
+}
+
 #endif // METRO_PATH_FINDER_H 
\ No newline at end of file
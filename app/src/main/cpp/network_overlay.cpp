@@ -0,0 +1,116 @@
+#include "network_overlay.h"
+#include <algorithm>
+
+NetworkOverlay::NetworkOverlay(const MetroGraph& metroGraph) : graph(metroGraph) {
+    clear();
+}
+
+bool NetworkOverlay::assignBit(std::vector<uint64_t>& bits, int index, bool value) {
+    uint64_t mask = static_cast<uint64_t>(1) << (index & 63);
+    uint64_t& word = bits[static_cast<size_t>(index) >> 6];
+    bool changed = ((word & mask) != 0) != value;
+    word = value ? (word | mask) : (word & ~mask);
+    return changed;
+}
+
+void NetworkOverlay::clear() {
+    size_t stationWords = (static_cast<size_t>(graph.getStationCount()) + 63) / 64;
+    size_t lineWords = (static_cast<size_t>(graph.getLineCount()) + 63) / 64;
+    closedStations.assign(stationWords, 0);
+    closedLines.assign(lineWords, 0);
+    segmentStations.assign(stationWords, 0);
+    lineTimeScale.assign(graph.getLineCount(), 1.0);
+    segments.clear();
+    closedStationCount = 0;
+    closedLineCount = 0;
+    scaledLineCount = 0;
+    minTimeScale = 1.0;
+    version++;
+}
+
+bool NetworkOverlay::setStationClosed(int stationId, bool closed) {
+    int index = graph.getStationIndex(stationId);
+    if (index < 0) {
+        return false;
+    }
+    if (assignBit(closedStations, index, closed)) {
+        closedStationCount += closed ? 1 : -1;
+        version++;
+    }
+    return true;
+}
+
+bool NetworkOverlay::setLineClosed(int lineId, bool closed) {
+    int lineIndex = graph.getLineIndex(lineId);
+    if (lineIndex < 0) {
+        return false;
+    }
+    if (assignBit(closedLines, lineIndex, closed)) {
+        closedLineCount += closed ? 1 : -1;
+        version++;
+    }
+    return true;
+}
+
+bool NetworkOverlay::setLineTimeScale(int lineId, double factor) {
+    int lineIndex = graph.getLineIndex(lineId);
+    if (lineIndex < 0 || !(factor > 0)) {
+        return false;
+    }
+    if ((lineTimeScale[lineIndex] != 1.0) != (factor != 1.0)) {
+        scaledLineCount += factor != 1.0 ? 1 : -1;
+    }
+    lineTimeScale[lineIndex] = factor;
+    refresh();
+    return true;
+}
+
+void NetworkOverlay::updateSegment(int fromIndex, int toIndex, bool closed, double timeScale) {
+    uint64_t key = segmentKey(fromIndex, toIndex);
+    if (!closed && timeScale == 1.0) {
+        segments.erase(key);
+    } else {
+        segments[key] = Segment{closed, timeScale};
+    }
+}
+
+bool NetworkOverlay::setSegmentClosed(int stationIdA, int stationIdB, bool closed) {
+    int indexA = graph.getStationIndex(stationIdA);
+    int indexB = graph.getStationIndex(stationIdB);
+    if (indexA < 0 || indexB < 0) {
+        return false;
+    }
+    auto it = segments.find(segmentKey(indexA, indexB));
+    double timeScale = it != segments.end() ? it->second.timeScale : 1.0;
+    updateSegment(indexA, indexB, closed, timeScale);
+    updateSegment(indexB, indexA, closed, timeScale);
+    refresh();
+    return true;
+}
+
+bool NetworkOverlay::setSegmentTimeScale(int stationIdA, int stationIdB, double factor) {
+    int indexA = graph.getStationIndex(stationIdA);
+    int indexB = graph.getStationIndex(stationIdB);
+    if (indexA < 0 || indexB < 0 || !(factor > 0)) {
+        return false;
+    }
+    auto it = segments.find(segmentKey(indexA, indexB));
+    bool closed = it != segments.end() && it->second.closed;
+    updateSegment(indexA, indexB, closed, factor);
+    updateSegment(indexB, indexA, closed, factor);
+    refresh();
+    return true;
+}
+
+void NetworkOverlay::refresh() {
+    std::fill(segmentStations.begin(), segmentStations.end(), 0);
+    minTimeScale = 1.0;
+    for (const auto& entry : segments) {
+        assignBit(segmentStations, static_cast<int>(entry.first >> 32), true);
+        minTimeScale = std::min(minTimeScale, entry.second.timeScale);
+    }
+    for (double factor : lineTimeScale) {
+        minTimeScale = std::min(minTimeScale, factor);
+    }
+    version++;
+}
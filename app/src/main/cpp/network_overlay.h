@@ -0,0 +1,109 @@
+#ifndef NETWORK_OVERLAY_H
+#define NETWORK_OVERLAY_H
+
+#include "metro_graph.h"
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+// Disruptions laid over a frozen MetroGraph without rebuilding it: closed stations,
+// lines and segments as bitsets, and time factors per line and per segment. Searches
+// ask getEdgeFactor for each hop; an empty overlay leaves the network as parsed.
+// Changes must not overlap with queries using the overlay.
+class NetworkOverlay {
+private:
+    // Closure or slowdown of the hops between two stations, on every line
+    struct Segment {
+        bool closed = false;
+        double timeScale = 1.0;
+    };
+
+    const MetroGraph& graph;
+    std::vector<uint64_t> closedStations;   // one bit per dense station index
+    std::vector<uint64_t> closedLines;      // one bit per dense line index
+    std::vector<uint64_t> segmentStations;  // stations some segment leaves from
+    std::vector<double> lineTimeScale;      // by dense line index, 1 = as scheduled
+    std::unordered_map<uint64_t, Segment> segments;
+    int closedStationCount = 0;
+    int closedLineCount = 0;
+    int scaledLineCount = 0;
+    double minTimeScale = 1.0;
+    uint32_t version = 0;
+
+    static bool testBit(const std::vector<uint64_t>& bits, int index) {
+        return (bits[static_cast<size_t>(index) >> 6] >> (index & 63)) & 1;
+    }
+
+    // Set or clear a bit; returns whether it changed
+    static bool assignBit(std::vector<uint64_t>& bits, int index, bool value);
+
+    static uint64_t segmentKey(int fromIndex, int toIndex) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(fromIndex)) << 32) | static_cast<uint32_t>(toIndex);
+    }
+
+    // Update one direction of a segment, dropping it once it is back to normal
+    void updateSegment(int fromIndex, int toIndex, bool closed, double timeScale);
+
+    // Recompute minTimeScale and segmentStations after a change
+    void refresh();
+
+public:
+    // Empty overlay sized for a frozen graph
+    explicit NetworkOverlay(const MetroGraph& metroGraph);
+
+    // Close or reopen a station (by stop_id): no path starts, ends or passes there.
+    // Returns false for unknown stations.
+    bool setStationClosed(int stationId, bool closed);
+
+    // Close or reopen every hop of a line (by line ID)
+    bool setLineClosed(int lineId, bool closed);
+
+    // Close or reopen the hops between two adjacent stations, both directions, all lines
+    bool setSegmentClosed(int stationIdA, int stationIdB, bool closed);
+
+    // Multiply ride times of a line, or of the hops between two stations in both
+    // directions, by factor (1 restores the schedule). Distances are unaffected.
+    bool setLineTimeScale(int lineId, double factor);
+    bool setSegmentTimeScale(int stationIdA, int stationIdB, double factor);
+
+    // Reopen everything and restore all times
+    void clear();
+
+    // Whether the overlay changes anything; precomputed accelerators (contraction
+    // hierarchies, route tables) describe the network as parsed and are only valid
+    // while this holds
+    bool isEmpty() const {
+        return closedStationCount == 0 && closedLineCount == 0 && scaledLineCount == 0 && segments.empty();
+    }
+
+    // Incremented on every change, for callers caching results
+    uint32_t getVersion() const { return version; }
+
+    // Smallest time factor in effect (at most 1), for scaling A* lower bounds
+    double getMinTimeScale() const { return minTimeScale; }
+
+    bool isStationOpen(int index) const { return !testBit(closedStations, index); }
+    bool isLineOpen(int lineIndex) const { return !testBit(closedLines, lineIndex); }
+
+    // Time factor of a hop between dense station indices on a dense line index, or
+    // infinity if the hop is closed
+    double getEdgeFactor(int fromIndex, int toIndex, int lineIndex) const {
+        if (testBit(closedStations, toIndex) || testBit(closedLines, lineIndex)) {
+            return std::numeric_limits<double>::infinity();
+        }
+        double factor = lineTimeScale[lineIndex];
+        if (testBit(segmentStations, fromIndex)) {
+            auto it = segments.find(segmentKey(fromIndex, toIndex));
+            if (it != segments.end()) {
+                if (it->second.closed) {
+                    return std::numeric_limits<double>::infinity();
+                }
+                factor *= it->second.timeScale;
+            }
+        }
+        return factor;
+    }
+};
+
+#endif // NETWORK_OVERLAY_H
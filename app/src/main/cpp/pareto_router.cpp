@@ -0,0 +1,213 @@
+#include "pareto_router.h"
+#include "cost_policy.h"
+#include <algorithm>
+#include <functional>
+
+// Slack for comparing sums of the same edge weights added in different orders
+static const double CRITERION_EPSILON = 1e-9;
+
+ParetoRouter::Workspace& ParetoRouter::threadWorkspace() {
+    thread_local Workspace workspace;
+    return workspace;
+}
+
+bool ParetoRouter::dominates(const Label& a, const Label& b) {
+    return a.time <= b.time + CRITERION_EPSILON &&
+           a.interchanges <= b.interchanges &&
+           a.distance <= b.distance + CRITERION_EPSILON;
+}
+
+bool ParetoRouter::insertLabel(Workspace& workspace, const Label& label, int maxBagSize) const {
+    std::vector<Label>& labels = workspace.labels;
+    int state = label.state;
+    if (workspace.bagStamp[state] != workspace.generation) {
+        workspace.bagStamp[state] = workspace.generation;
+        workspace.bagSize[state] = 0;
+    }
+    int* bag = &workspace.bagLabels[static_cast<size_t>(state) * workspace.bagCapacity];
+    int size = workspace.bagSize[state];
+    for (int i = 0; i < size; i++) {
+        if (dominates(labels[bag[i]], label)) {
+            return false;
+        }
+    }
+
+    // Nothing that a journey already at the target beats can lead to a new trade-off
+    for (int targetLabel : workspace.targetLabels) {
+        if (!labels[targetLabel].dominated && dominates(labels[targetLabel], label)) {
+            return false;
+        }
+    }
+
+    // Drop the labels the new one beats, keeping the bag compact
+    int kept = 0;
+    for (int i = 0; i < size; i++) {
+        if (dominates(label, labels[bag[i]])) {
+            labels[bag[i]].dominated = true;
+        } else {
+            bag[kept++] = bag[i];
+        }
+    }
+    workspace.bagSize[state] = kept;
+    if (kept == maxBagSize) {
+        return false;
+    }
+    int labelIndex = static_cast<int>(labels.size());
+    labels.push_back(label);
+    bag[kept] = labelIndex;
+    workspace.bagSize[state] = kept + 1;
+
+    // Journeys arriving on other lines compete at the target too
+    if (graph.getStateStation(state) == workspace.targetStation) {
+        for (int targetLabel : workspace.targetLabels) {
+            if (dominates(label, labels[targetLabel])) {
+                labels[targetLabel].dominated = true;
+            }
+        }
+        workspace.targetLabels.push_back(labelIndex);
+    }
+    return true;
+}
+
+MetroPath ParetoRouter::buildPath(const Workspace& workspace, int labelIndex, int sourceIndex) const {
+    const Label& last = workspace.labels[labelIndex];
+    MetroPath path;
+    std::vector<int> lineIndices;
+    for (int i = labelIndex; workspace.labels[i].state >= 0; i = workspace.labels[i].parent) {
+        int state = workspace.labels[i].state;
+        path.stationIds.push_back(graph.getStationIdAt(graph.getStateStation(state)));
+        lineIndices.push_back(graph.getStateLine(state));
+    }
+    path.stationIds.push_back(graph.getStationIdAt(sourceIndex));
+    std::reverse(path.stationIds.begin(), path.stationIds.end());
+    std::reverse(lineIndices.begin(), lineIndices.end());
+    for (int line : lineIndices) {
+        path.lineIds.push_back(graph.getLineIdAt(line));
+    }
+
+    // The label counts the interchanges it was charged for; the path also counts
+    // changes across a walk
+    path.totalTime = last.time;
+    path.totalDistance = last.distance;
+    path.interchangeCount = graph.countInterchangesAt(lineIndices);
+    return path;
+}
+
+std::vector<MetroPath> ParetoRouter::findParetoPaths(int sourceId, int targetId, int maxBagSize) const {
+    std::vector<MetroPath> paths;
+    if (!graph.isFrozen() || maxBagSize < 1) {
+        return paths;
+    }
+
+    int sourceIndex = graph.getStationIndex(sourceId);
+    int targetIndex = graph.getStationIndex(targetId);
+    if (sourceIndex < 0 || targetIndex < 0) {
+        return paths;
+    }
+    if (sourceIndex == targetIndex) {
+        MetroPath path;
+        path.stationIds.push_back(sourceId);
+        paths.push_back(path);
+        return paths;
+    }
+
+    // Reset the workspace; bags are only reallocated when the graph or capacity changes
+    Workspace& workspace = threadWorkspace();
+    size_t stateCount = static_cast<size_t>(graph.getStateCount());
+    if (workspace.bagCapacity != maxBagSize || workspace.bagStamp.size() != stateCount) {
+        workspace.bagCapacity = maxBagSize;
+        workspace.bagStamp.assign(stateCount, 0);
+        workspace.bagSize.assign(stateCount, 0);
+        workspace.bagLabels.assign(stateCount * maxBagSize, -1);
+        workspace.expandStamp.assign(stateCount, 0);
+        workspace.expandTime.assign(stateCount, 0);
+        workspace.expandDistance.assign(stateCount, 0);
+        workspace.generation = 0;
+    }
+    if (++workspace.generation == 0) {
+        std::fill(workspace.bagStamp.begin(), workspace.bagStamp.end(), 0);
+        workspace.generation = 1;
+    }
+    std::fill(workspace.expandStamp.begin(), workspace.expandStamp.end(), 0);
+    workspace.labels.clear();
+    workspace.heap.clear();
+    workspace.targetLabels.clear();
+    workspace.targetStation = targetIndex;
+    workspace.stats = SearchStats();
+
+    std::vector<Label>& labels = workspace.labels;
+    std::vector<HeapEntry>& heap = workspace.heap;
+    std::greater<> heapCompare;
+
+    labels.push_back(Label{0, 0, 0, -1, -1, false});
+    heap.push_back(HeapEntry{0, 0, 0, 0});
+    workspace.stats.heapPushes++;
+
+    // Labels come off the heap in lexicographic order, so a label that is still
+    // undominated when popped is final
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), heapCompare);
+        int labelIndex = heap.back().label;
+        heap.pop_back();
+        workspace.stats.heapPops++;
+
+        Label current = labels[labelIndex];
+        if (current.dominated) {
+            continue;
+        }
+        workspace.stats.settledNodes++;
+
+        int station = current.state < 0 ? sourceIndex : graph.getStateStation(current.state);
+        if (station == targetIndex) {
+            continue;
+        }
+        int line = current.state < 0 ? -1 : graph.getStateLine(current.state);
+
+        for (const CsrEdge& edge : graph.getEdges(station)) {
+            workspace.stats.relaxedEdges++;
+            Label next{current.time + edge.time, current.distance + edge.distance, current.interchanges,
+                       graph.getEdgeTargetState(graph.getEdgeIndex(edge)), labelIndex, false};
+
+            // Only add penalty for REAL interchanges (different line colors)
+            if (line >= 0 && graph.isInterchangeAt(line, edge.lineIndex)) {
+                next.time += INTERCHANGE_PENALTY_MINUTES;
+                next.interchanges++;
+            }
+
+            // A parallel edge into the same state that is no cheaper than one already
+            // tried from this label can't do better than it did
+            uint32_t expansion = static_cast<uint32_t>(labelIndex) + 1;
+            if (workspace.expandStamp[next.state] == expansion &&
+                workspace.expandTime[next.state] <= next.time &&
+                workspace.expandDistance[next.state] <= next.distance) {
+                continue;
+            }
+            workspace.expandStamp[next.state] = expansion;
+            workspace.expandTime[next.state] = next.time;
+            workspace.expandDistance[next.state] = next.distance;
+
+            if (insertLabel(workspace, next, maxBagSize)) {
+                int nextIndex = static_cast<int>(labels.size()) - 1;
+                heap.push_back(HeapEntry{next.time, next.interchanges, next.distance, nextIndex});
+                std::push_heap(heap.begin(), heap.end(), heapCompare);
+                workspace.stats.heapPushes++;
+            }
+        }
+    }
+
+    // Surviving target labels, fastest first
+    std::vector<int> results;
+    for (int targetLabel : workspace.targetLabels) {
+        if (!labels[targetLabel].dominated) {
+            results.push_back(targetLabel);
+        }
+    }
+    std::sort(results.begin(), results.end(), [&](int a, int b) {
+        return HeapEntry{labels[b].time, labels[b].interchanges, labels[b].distance, b} >
+               HeapEntry{labels[a].time, labels[a].interchanges, labels[a].distance, a};
+    });
+    for (int result : results) {
+        paths.push_back(buildPath(workspace, result, sourceIndex));
+    }
+    return paths;
+}
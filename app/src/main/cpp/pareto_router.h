@@ -0,0 +1,85 @@
+#ifndef PARETO_ROUTER_H
+#define PARETO_ROUTER_H
+
+#include "metro_graph.h"
+#include "query_workspace.h"
+#include <cstdint>
+#include <vector>
+
+// Multi-criteria label-setting search over (time, interchanges, distance). Labels
+// live on the line-aware states of the graph, so an interchange is known exactly
+// when a label leaves a state; time still includes the interchange penalty,
+// as in MetroPathFinder.
+class ParetoRouter {
+private:
+    // One partial journey: its criteria, where it is and the label it extends
+    struct Label {
+        double time;
+        double distance;
+        int interchanges;
+        int state;              // -1 for the source label
+        int parent;             // Index into the label pool, -1 for the source label
+        bool dominated;
+    };
+
+    // Heap entry keyed lexicographically by (time, interchanges, distance)
+    struct HeapEntry {
+        double time;
+        int interchanges;
+        double distance;
+        int label;
+
+        bool operator>(const HeapEntry& other) const {
+            if (time != other.time) return time > other.time;
+            if (interchanges != other.interchanges) return interchanges > other.interchanges;
+            return distance > other.distance;
+        }
+    };
+
+    // Scratch space reused across queries on a thread: the label pool and a fixed
+    // number of bag slots per state, reset in O(1) by generation stamps
+    struct Workspace {
+        uint32_t generation = 0;
+        std::vector<Label> labels;
+        std::vector<HeapEntry> heap;
+        std::vector<uint32_t> bagStamp;
+        std::vector<int> bagSize;
+        std::vector<int> bagLabels;         // [state * bagCapacity + slot]
+        std::vector<int> targetLabels;
+        std::vector<uint32_t> expandStamp;  // Label that last generated a candidate for a state
+        std::vector<double> expandTime;     // and that candidate's time and distance
+        std::vector<double> expandDistance;
+        int targetStation = -1;
+        int bagCapacity = 0;
+        SearchStats stats;
+    };
+
+    const MetroGraph& graph;
+
+    static Workspace& threadWorkspace();
+
+    // True if a is no worse than b in every criterion
+    static bool dominates(const Label& a, const Label& b);
+
+    // Add a label to its state's bag and the pool unless the bag or the target labels
+    // dominate it; labels it dominates are dropped. Returns false if it wasn't added.
+    bool insertLabel(Workspace& workspace, const Label& label, int maxBagSize) const;
+
+    // Build the MetroPath ending with a target label
+    MetroPath buildPath(const Workspace& workspace, int labelIndex, int sourceIndex) const;
+
+public:
+    static const int DEFAULT_MAX_BAG_SIZE = 8;
+
+    explicit ParetoRouter(const MetroGraph& metroGraph) : graph(metroGraph) {}
+
+    // All non-dominated paths from sourceId to targetId, fastest first. Each state
+    // keeps at most maxBagSize labels; once a bag is full further labels for it are
+    // dropped, which bounds the work but can miss slower trade-offs.
+    std::vector<MetroPath> findParetoPaths(int sourceId, int targetId, int maxBagSize = DEFAULT_MAX_BAG_SIZE) const;
+
+    // Counters of the last query on the calling thread (settled = labels expanded)
+    static const SearchStats& getLastSearchStats() { return threadWorkspace().stats; }
+};
+
+#endif // PARETO_ROUTER_H
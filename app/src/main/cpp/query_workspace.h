@@ -0,0 +1,266 @@
+#ifndef QUERY_WORKSPACE_H
+#define QUERY_WORKSPACE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+// Priority queue entry for Dijkstra-style searches (stations and lines are dense indices)
+struct DijkstraNode {
+    int stationId;
+    double cost;
+    int prevStationId;
+    int lineId;
+    
+    // Constructor
+    DijkstraNode(int id, double c, int prev, int line) 
+        : stationId(id), cost(c), prevStationId(prev), lineId(line) {}
+    
+    // Comparison operator for priority queue; equal costs are ordered by the other
+    // fields so that every queue pops them in the same order
+    bool operator>(const DijkstraNode& other) const {
+        if (cost != other.cost) {
+            return cost > other.cost;
+        }
+        if (stationId != other.stationId) {
+            return stationId > other.stationId;
+        }
+        if (lineId != other.lineId) {
+            return lineId > other.lineId;
+        }
+        return prevStationId > other.prevStationId;
+    }
+};
+
+// Counters for the last search, for comparing algorithms
+struct SearchStats {
+    int settledNodes = 0;
+    int relaxedEdges = 0;
+    int heapPushes = 0;
+    int heapPops = 0;
+};
+
+// Reusable scratch space for one search at a time, meant to be owned per thread.
+// Arrays are indexed by dense node index and only count as written when their
+// stamp matches the current generation, so starting a new query is O(1) and
+// no memory is allocated once the arrays have grown to the graph size.
+class QueryWorkspace {
+private:
+    uint32_t generation = 0;
+    std::vector<uint32_t> reachedStamp;
+    std::vector<uint32_t> settledStamp;
+    std::vector<double> dist;
+    std::vector<int> prevNode;
+    std::vector<int> prevLine;
+    std::vector<double> secondaryCost;
+    std::vector<uint32_t> stationStamp;
+    std::unique_ptr<QueryWorkspace> backwardWorkspace;
+
+public:
+    // Binary heap storage, kept between queries so its capacity is reused
+    std::vector<DijkstraNode> heap;
+    
+    // Bucket storage for BucketQueue, likewise kept between queries
+    std::vector<std::vector<DijkstraNode>> buckets;
+    std::vector<DijkstraNode> bucketOverflow;
+    
+    // Counters for the current (or last finished) search
+    SearchStats stats;
+    
+    // Start a new query over a graph with nodeCount nodes
+    void begin(size_t nodeCount) {
+        if (reachedStamp.size() < nodeCount) {
+            reachedStamp.resize(nodeCount, 0);
+            settledStamp.resize(nodeCount, 0);
+            dist.resize(nodeCount);
+            prevNode.resize(nodeCount);
+            prevLine.resize(nodeCount);
+            secondaryCost.resize(nodeCount);
+        }
+        
+        // On wrap-around, old stamps could alias the new generation
+        if (++generation == 0) {
+            std::fill(reachedStamp.begin(), reachedStamp.end(), 0);
+            std::fill(settledStamp.begin(), settledStamp.end(), 0);
+            std::fill(stationStamp.begin(), stationStamp.end(), 0);
+            generation = 1;
+        }
+        heap.clear();
+        stats = SearchStats();
+    }
+    
+    // Tentative distance of a node, infinity if not reached in this query
+    double getDist(int node) const {
+        return reachedStamp[node] == generation ? dist[node] : std::numeric_limits<double>::infinity();
+    }
+    
+    // Record a tentative distance and the edge it was reached by
+    void setDist(int node, double d, int prev, int line) {
+        reachedStamp[node] = generation;
+        dist[node] = d;
+        prevNode[node] = prev;
+        prevLine[node] = line;
+    }
+    
+    int getPrevNode(int node) const { return prevNode[node]; }
+    int getPrevLine(int node) const { return prevLine[node]; }
+    
+    // Second set of arrays for searches that also run backwards, created on first use
+    QueryWorkspace& backward() {
+        if (!backwardWorkspace) {
+            backwardWorkspace.reset(new QueryWorkspace());
+        }
+        return *backwardWorkspace;
+    }
+    
+    bool isSettled(int node) const { return settledStamp[node] == generation; }
+    void markSettled(int node) { settledStamp[node] = generation; }
+    
+    // A second cost per node (e.g. the distance along the fastest path), only valid
+    // for nodes the search has set it on in this query
+    double getSecondaryCost(int node) const { return secondaryCost[node]; }
+    void setSecondaryCost(int node, double cost) { secondaryCost[node] = cost; }
+    
+    // Per-station marks for searches over line-aware states; call after begin, and
+    // every station starts unmarked
+    void beginStationMarks(size_t stationCount) {
+        if (stationStamp.size() < stationCount) {
+            stationStamp.resize(stationCount, 0);
+        }
+    }
+    bool isStationMarked(int station) const { return stationStamp[station] == generation; }
+    void markStation(int station) { stationStamp[station] = generation; }
+};
+
+// Priority queues for DijkstraNode keyed by cost, interchangeable as the Queue
+// parameter of a search. Both keep their storage in a QueryWorkspace and count
+// operations in its stats.
+
+// Binary min-heap on the workspace heap
+class BinaryHeapQueue {
+private:
+    std::vector<DijkstraNode>& heap;
+    SearchStats& stats;
+
+public:
+    // The resolution is unused; it keeps the constructor the same as BucketQueue's
+    BinaryHeapQueue(QueryWorkspace& workspace, double /*resolution*/)
+        : heap(workspace.heap), stats(workspace.stats) {
+        heap.clear();
+    }
+    
+    bool empty() const { return heap.empty(); }
+    
+    void push(const DijkstraNode& node) {
+        heap.push_back(node);
+        std::push_heap(heap.begin(), heap.end(), std::greater<>());
+        stats.heapPushes++;
+    }
+    
+    DijkstraNode pop() {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<>());
+        DijkstraNode node = heap.back();
+        heap.pop_back();
+        stats.heapPops++;
+        return node;
+    }
+};
+
+// Monotone bucket queue (Dial): costs are quantized to buckets of width resolution
+// and only the bucket being drained is kept as a small binary heap, so pops come out
+// in exactly the order BinaryHeapQueue gives while pushes to later buckets are O(1).
+// A key below the bucket being drained goes into that heap and is still popped first.
+// Keys from MAX_BUCKETS buckets on are held together and, once every bucket before
+// them is drained, popped as one binary heap, so a tiny resolution or a huge cost
+// can't grow the bucket array without bound.
+class BucketQueue {
+private:
+    std::vector<std::vector<DijkstraNode>>& buckets;
+    std::vector<DijkstraNode>& current;     // Entries of the bucket being drained, as a heap
+    std::vector<DijkstraNode>& overflow;    // Entries with keys from MAX_BUCKETS on
+    SearchStats& stats;
+    double scale;
+    size_t currentBucket = 0;
+    size_t lastBucket = 0;
+    size_t count = 0;
+    
+    // Bucket of a cost, MAX_BUCKETS for any cost past the last bucket
+    size_t bucketOf(double cost) const {
+        double bucket = cost * scale;
+        if (!(bucket > 0)) {
+            return 0;
+        }
+        return bucket < MAX_BUCKETS ? static_cast<size_t>(bucket) : MAX_BUCKETS;
+    }
+
+public:
+    static constexpr size_t MAX_BUCKETS = 1 << 16;
+    
+    // A resolution that isn't positive puts every key in the first bucket, which
+    // leaves a plain binary heap
+    BucketQueue(QueryWorkspace& workspace, double resolution)
+        : buckets(workspace.buckets), current(workspace.heap), overflow(workspace.bucketOverflow),
+          stats(workspace.stats), scale(resolution > 0 ? 1.0 / resolution : 0) {
+        current.clear();
+        overflow.clear();
+    }
+    
+    // Leave the workspace buckets empty for the next query, even after an early exit
+    ~BucketQueue() {
+        for (size_t bucket = currentBucket + 1; bucket <= lastBucket && bucket < buckets.size(); bucket++) {
+            buckets[bucket].clear();
+        }
+        overflow.clear();
+    }
+    
+    BucketQueue(const BucketQueue&) = delete;
+    BucketQueue& operator=(const BucketQueue&) = delete;
+    
+    bool empty() const { return count == 0; }
+    
+    void push(const DijkstraNode& node) {
+        size_t bucket = bucketOf(node.cost);
+        if (bucket <= currentBucket) {
+            current.push_back(node);
+            std::push_heap(current.begin(), current.end(), std::greater<>());
+        } else if (bucket == MAX_BUCKETS) {
+            overflow.push_back(node);
+        } else {
+            if (bucket >= buckets.size()) {
+                buckets.resize(bucket + 1);
+            }
+            buckets[bucket].push_back(node);
+            lastBucket = std::max(lastBucket, bucket);
+        }
+        count++;
+        stats.heapPushes++;
+    }
+    
+    DijkstraNode pop() {
+        // Move on to the next non-empty bucket and heapify it; past the last one only
+        // the overflow is left, and every later push joins it in the heap
+        if (current.empty()) {
+            do {
+                currentBucket++;
+            } while (currentBucket <= lastBucket && buckets[currentBucket].empty());
+            if (currentBucket <= lastBucket) {
+                current.swap(buckets[currentBucket]);
+            } else {
+                currentBucket = MAX_BUCKETS;
+                current.swap(overflow);
+            }
+            std::make_heap(current.begin(), current.end(), std::greater<>());
+        }
+        std::pop_heap(current.begin(), current.end(), std::greater<>());
+        DijkstraNode node = current.back();
+        current.pop_back();
+        count--;
+        stats.heapPops++;
+        return node;
+    }
+};
+
+#endif // QUERY_WORKSPACE_H
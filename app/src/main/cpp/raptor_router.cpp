@@ -0,0 +1,304 @@
+#include "raptor_router.h"
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <utility>
+
+static const int SECONDS_PER_DAY = 24 * 3600;
+
+RaptorRouter::RaptorRouter(const Timetable& timetable, const MetroGraph& metroGraph) : graph(metroGraph) {
+    // Group trips by line and stop sequence (dense station indices)
+    std::map<std::pair<int, std::vector<int>>, std::vector<int>> tripsBySequence;
+    std::vector<int> stations;
+    for (size_t i = 0; i < timetable.trips.size(); i++) {
+        const TimetableTrip& trip = timetable.trips[i];
+        stations.clear();
+        for (int stopId : trip.stopIds) {
+            int index = graph.getStationIndex(stopId);
+            if (index < 0) {
+                break;
+            }
+            stations.push_back(index);
+        }
+        if (stations.size() < 2 || stations.size() != trip.stopIds.size()) {
+            continue;
+        }
+        tripsBySequence[std::make_pair(trip.routeId, stations)].push_back(static_cast<int>(i));
+    }
+
+    for (auto& group : tripsBySequence) {
+        const std::vector<int>& sequence = group.first.second;
+        std::vector<int>& tripIndices = group.second;
+        std::sort(tripIndices.begin(), tripIndices.end(), [&](int a, int b) {
+            return timetable.trips[a].departureTimes[0] < timetable.trips[b].departureTimes[0];
+        });
+
+        // A trip joins the first route whose last trip it never overtakes; otherwise
+        // it starts a new route with the same stops
+        std::vector<std::vector<int>> routeTrips;
+        for (int tripIndex : tripIndices) {
+            const TimetableTrip& trip = timetable.trips[tripIndex];
+            bool placed = false;
+            for (std::vector<int>& candidate : routeTrips) {
+                const TimetableTrip& last = timetable.trips[candidate.back()];
+                bool ordered = true;
+                for (size_t s = 0; s < sequence.size() && ordered; s++) {
+                    ordered = last.arrivalTimes[s] <= trip.arrivalTimes[s] &&
+                              last.departureTimes[s] <= trip.departureTimes[s];
+                }
+                if (ordered) {
+                    candidate.push_back(tripIndex);
+                    placed = true;
+                    break;
+                }
+            }
+            if (!placed) {
+                routeTrips.push_back(std::vector<int>(1, tripIndex));
+            }
+        }
+
+        for (const std::vector<int>& trips : routeTrips) {
+            Route route;
+            route.lineId = group.first.first;
+            route.firstStop = static_cast<int>(routeStops.size());
+            route.stopCount = static_cast<int>(sequence.size());
+            route.firstTrip = static_cast<int>(tripWeekdays.size());
+            route.tripCount = static_cast<int>(trips.size());
+            route.firstStopTime = static_cast<int>(stopTimes.size());
+            routes.push_back(route);
+
+            routeStops.insert(routeStops.end(), sequence.begin(), sequence.end());
+            for (int tripIndex : trips) {
+                const TimetableTrip& trip = timetable.trips[tripIndex];
+                for (size_t s = 0; s < sequence.size(); s++) {
+                    stopTimes.push_back(StopTime{trip.arrivalTimes[s], trip.departureTimes[s]});
+                }
+                // A trip without a known service is assumed to run every day
+                tripWeekdays.push_back(trip.serviceIndex >= 0 ?
+                    timetable.services[trip.serviceIndex].weekdays : static_cast<uint8_t>(0x7F));
+            }
+        }
+    }
+
+    // Routes serving each station, with the position to board at (never the last stop)
+    int stationCount = graph.getStationCount();
+    stopRouteOffsets.assign(stationCount + 1, 0);
+    for (const Route& route : routes) {
+        for (int i = 0; i + 1 < route.stopCount; i++) {
+            stopRouteOffsets[routeStops[route.firstStop + i] + 1]++;
+        }
+    }
+    for (int station = 0; station < stationCount; station++) {
+        stopRouteOffsets[station + 1] += stopRouteOffsets[station];
+    }
+    stopRoutes.resize(stopRouteOffsets[stationCount]);
+    std::vector<int> fill(stopRouteOffsets.begin(), stopRouteOffsets.end() - 1);
+    for (size_t r = 0; r < routes.size(); r++) {
+        const Route& route = routes[r];
+        for (int i = 0; i + 1 < route.stopCount; i++) {
+            stopRoutes[fill[routeStops[route.firstStop + i]]++] = StopRoute{static_cast<int>(r), i};
+        }
+    }
+}
+
+int RaptorRouter::findEarliestTrip(const Route& route, int position, int time, int weekday) const {
+    // Departures at a position rise with the trip index, so binary search the first candidate
+    int low = 0;
+    int high = route.tripCount;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (stopTimes[route.firstStopTime + mid * route.stopCount + position].departure < time) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    uint8_t dayBit = static_cast<uint8_t>(1 << weekday);
+    for (int trip = low; trip < route.tripCount; trip++) {
+        if (tripWeekdays[route.firstTrip + trip] & dayBit) {
+            return trip;
+        }
+    }
+    return -1;
+}
+
+TimetableJourney RaptorRouter::findEarliestArrival(int sourceId, int targetId, int departureTime, int dayOfWeek,
+                                                   int maxRounds, int changeSeconds) const {
+    TimetableJourney journey;
+    int sourceIndex = graph.getStationIndex(sourceId);
+    int targetIndex = graph.getStationIndex(targetId);
+    if (sourceIndex < 0 || targetIndex < 0 || dayOfWeek < 0 || dayOfWeek > 6 || maxRounds < 1) {
+        return journey;
+    }
+
+    if (sourceIndex == targetIndex) {
+        journey.path.stationIds.push_back(sourceId);
+        journey.departureTime = departureTime;
+        journey.arrivalTime = departureTime;
+        return journey;
+    }
+
+    // How a station was reached in a round: the trip ridden (-1 if carried over
+    // from the round before) and where it was boarded and left
+    struct Label {
+        int route = -1;
+        int trip = -1;
+        int shift = 0;          // 0 for today's trips, -SECONDS_PER_DAY for yesterday's
+        int boardPosition = -1;
+        int alightPosition = -1;
+    };
+
+    int stationCount = graph.getStationCount();
+    std::vector<int> bestArrival(stationCount, INT_MAX);
+    std::vector<int> arrival(static_cast<size_t>(maxRounds + 1) * stationCount, INT_MAX);
+    std::vector<Label> labels(arrival.size());
+    std::vector<char> marked(stationCount, 0);
+    std::vector<int> markedStations;
+    std::vector<int> routeStart(routes.size(), -1);
+    std::vector<int> touchedRoutes;
+
+    arrival[sourceIndex] = departureTime;
+    bestArrival[sourceIndex] = departureTime;
+    marked[sourceIndex] = 1;
+    markedStations.push_back(sourceIndex);
+
+    int yesterday = (dayOfWeek + 6) % 7;
+    for (int k = 1; k <= maxRounds && !markedStations.empty(); k++) {
+        int* previous = &arrival[static_cast<size_t>(k - 1) * stationCount];
+        int* current = &arrival[static_cast<size_t>(k) * stationCount];
+        Label* currentLabels = &labels[static_cast<size_t>(k) * stationCount];
+        std::copy(previous, previous + stationCount, current);
+
+        // Routes through stations improved last round, from the earliest such stop
+        touchedRoutes.clear();
+        for (int station : markedStations) {
+            marked[station] = 0;
+            for (int i = stopRouteOffsets[station]; i < stopRouteOffsets[station + 1]; i++) {
+                const StopRoute& stopRoute = stopRoutes[i];
+                if (routeStart[stopRoute.route] < 0) {
+                    touchedRoutes.push_back(stopRoute.route);
+                    routeStart[stopRoute.route] = stopRoute.position;
+                } else {
+                    routeStart[stopRoute.route] = std::min(routeStart[stopRoute.route], stopRoute.position);
+                }
+            }
+        }
+        markedStations.clear();
+
+        for (int r : touchedRoutes) {
+            const Route& route = routes[r];
+            int trip = -1;
+            int shift = 0;
+            int boardPosition = -1;
+
+            for (int i = routeStart[r]; i < route.stopCount; i++) {
+                int station = routeStops[route.firstStop + i];
+                const StopTime* times = &stopTimes[route.firstStopTime + i];
+
+                // Ride on: stop here if that beats every earlier arrival and the target's
+                if (trip >= 0) {
+                    int arrivalTime = times[trip * route.stopCount].arrival + shift;
+                    if (arrivalTime < std::min(bestArrival[station], bestArrival[targetIndex])) {
+                        current[station] = arrivalTime;
+                        bestArrival[station] = arrivalTime;
+                        Label& label = currentLabels[station];
+                        label.route = r;
+                        label.trip = trip;
+                        label.shift = shift;
+                        label.boardPosition = boardPosition;
+                        label.alightPosition = i;
+                        if (!marked[station]) {
+                            marked[station] = 1;
+                            markedStations.push_back(station);
+                        }
+                    }
+                }
+
+                // Board here, or switch to an earlier trip, if last round got here in time
+                if (previous[station] == INT_MAX || i + 1 == route.stopCount) {
+                    continue;
+                }
+                int ready = previous[station] + (station == sourceIndex ? 0 : changeSeconds);
+                if (trip >= 0 && times[trip * route.stopCount].departure + shift < ready) {
+                    continue;
+                }
+
+                int todayTrip = findEarliestTrip(route, i, ready, dayOfWeek);
+                int yesterdayTrip = findEarliestTrip(route, i, ready + SECONDS_PER_DAY, yesterday);
+                int bestTrip = trip;
+                int bestShift = shift;
+                int bestDeparture = trip >= 0 ? times[trip * route.stopCount].departure + shift : INT_MAX;
+                if (todayTrip >= 0 && times[todayTrip * route.stopCount].departure < bestDeparture) {
+                    bestTrip = todayTrip;
+                    bestShift = 0;
+                    bestDeparture = times[todayTrip * route.stopCount].departure;
+                }
+                if (yesterdayTrip >= 0 &&
+                    times[yesterdayTrip * route.stopCount].departure - SECONDS_PER_DAY < bestDeparture) {
+                    bestTrip = yesterdayTrip;
+                    bestShift = -SECONDS_PER_DAY;
+                    bestDeparture = times[yesterdayTrip * route.stopCount].departure - SECONDS_PER_DAY;
+                }
+                if (bestTrip != trip || bestShift != shift) {
+                    trip = bestTrip;
+                    shift = bestShift;
+                    boardPosition = i;
+                }
+            }
+            routeStart[r] = -1;
+        }
+    }
+
+    if (bestArrival[targetIndex] == INT_MAX) {
+        return journey;
+    }
+
+    // Fewest trains among the rounds reaching the target at the earliest time
+    int round = 1;
+    while (arrival[static_cast<size_t>(round) * stationCount + targetIndex] != bestArrival[targetIndex]) {
+        round++;
+    }
+
+    // Walk the rides back from the target
+    std::vector<Label> rides;
+    for (int station = targetIndex; station != sourceIndex; ) {
+        const Label& label = labels[static_cast<size_t>(round) * stationCount + station];
+        if (label.route < 0) {
+            round--;
+            continue;
+        }
+        rides.push_back(label);
+        station = routeStops[routes[label.route].firstStop + label.boardPosition];
+        round--;
+    }
+    std::reverse(rides.begin(), rides.end());
+
+    MetroPath& path = journey.path;
+    path.stationIds.push_back(sourceIndex);
+    for (const Label& ride : rides) {
+        const Route& route = routes[ride.route];
+        for (int i = ride.boardPosition + 1; i <= ride.alightPosition; i++) {
+            int station = routeStops[route.firstStop + i];
+            path.totalDistance += graph.getStraightLineDistance(path.stationIds.back(), station);
+            path.stationIds.push_back(station);
+            path.lineIds.push_back(route.lineId);
+        }
+    }
+    for (size_t i = 1; i < rides.size(); i++) {
+        if (graph.isInterchange(routes[rides[i - 1].route].lineId, routes[rides[i].route].lineId)) {
+            path.interchangeCount++;
+        }
+    }
+    for (int& station : path.stationIds) {
+        station = graph.getStationIdAt(station);
+    }
+
+    const Route& firstRoute = routes[rides.front().route];
+    journey.departureTime = stopTimes[firstRoute.firstStopTime + rides.front().trip * firstRoute.stopCount +
+                                      rides.front().boardPosition].departure + rides.front().shift;
+    journey.arrivalTime = bestArrival[targetIndex];
+    journey.rounds = static_cast<int>(rides.size());
+    path.totalTime = (journey.arrivalTime - departureTime) / 60.0;
+    return journey;
+}
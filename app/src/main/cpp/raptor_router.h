@@ -0,0 +1,80 @@
+#ifndef RAPTOR_ROUTER_H
+#define RAPTOR_ROUTER_H
+
+#include "metro_graph.h"
+#include "timetable.h"
+#include <cstdint>
+#include <vector>
+
+// Answer of a timetable query: the trains taken and the clock times, in
+// seconds after midnight of the query day
+struct TimetableJourney {
+    MetroPath path;             // totalTime runs from the requested departure to arrival
+    int departureTime = -1;     // When the first train leaves the source
+    int arrivalTime = -1;       // When the last train reaches the target
+    int rounds = 0;             // Trains boarded
+};
+
+// Round-based earliest-arrival router (RAPTOR) over the scheduled trips.
+// Trips running the same stop sequence form a route; each round rides every
+// route touched by the stops improved in the round before, so the number of
+// rounds bounds the number of trains boarded.
+class RaptorRouter {
+private:
+    // Trips of a route share its stops and never overtake each other, so they
+    // are sorted by departure at every stop
+    struct Route {
+        int lineId;
+        int firstStop;          // Offset into routeStops
+        int stopCount;
+        int firstTrip;          // Offset into tripWeekdays; trip t's times start at
+        int tripCount;          // stopTimes[firstStopTime + t * stopCount]
+        int firstStopTime;
+    };
+
+    struct StopTime {
+        int arrival;
+        int departure;
+    };
+
+    // A route serving a stop, and the stop's position along it
+    struct StopRoute {
+        int route;
+        int position;
+    };
+
+    const MetroGraph& graph;
+    std::vector<Route> routes;
+    std::vector<int> routeStops;            // Dense station indices
+    std::vector<StopTime> stopTimes;
+    std::vector<uint8_t> tripWeekdays;      // Weekday bits of each trip's service
+    std::vector<int> stopRouteOffsets;      // size = station count + 1
+    std::vector<StopRoute> stopRoutes;
+
+    // Earliest trip of a route leaving a position at or after a time on a weekday
+    // (bit index), or -1
+    int findEarliestTrip(const Route& route, int position, int time, int weekday) const;
+
+public:
+    // Build the flat route/trip/stop arrays for a frozen graph; trips with stops
+    // the graph doesn't know are skipped
+    RaptorRouter(const Timetable& timetable, const MetroGraph& metroGraph);
+
+    static const int DEFAULT_MAX_ROUNDS = 6;
+    static const int DEFAULT_CHANGE_SECONDS = 180;
+
+    // Number of routes (distinct stop sequences) and trips in the layout
+    int getRouteCount() const { return static_cast<int>(routes.size()); }
+    int getTripCount() const { return static_cast<int>(tripWeekdays.size()); }
+
+    // Earliest arrival at targetId leaving sourceId at departureTime (seconds after
+    // midnight) on dayOfWeek (0 = Monday ... 6 = Sunday). Trips of the previous
+    // service day still running after midnight are included. Changing trains takes
+    // at least changeSeconds. The path is empty if the target can't be reached
+    // within maxRounds trains.
+    TimetableJourney findEarliestArrival(int sourceId, int targetId, int departureTime, int dayOfWeek,
+                                         int maxRounds = DEFAULT_MAX_ROUNDS,
+                                         int changeSeconds = DEFAULT_CHANGE_SECONDS) const;
+};
+
+#endif // RAPTOR_ROUTER_H
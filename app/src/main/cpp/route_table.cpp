@@ -0,0 +1,320 @@
+#include "route_table.h"
+#include "cost_policy.h"
+#include "task_pool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+static const char ROUTE_TABLE_MAGIC[4] = {'M', 'R', 'T', 'B'};
+
+// Byte size of a blob for the given counts
+static size_t blobSize(size_t stationCount, size_t stateCount) {
+    return sizeof(RouteTableHeader) +
+           2 * stationCount * stationCount * sizeof(RouteTableEntry) +
+           stateCount * stationCount * sizeof(uint16_t);
+}
+
+// Scratch arrays for the backward searches of one worker thread
+struct RouteTableWorker {
+    std::vector<double> cost;
+    std::vector<int> next;
+    std::vector<int> hopLine;
+    std::vector<double> hopDistance;
+    std::vector<double> hopTime;
+    std::vector<double> otherTotal;
+    std::vector<int> interchanges;
+    std::vector<bool> settled;
+    std::vector<int> settleOrder;
+    std::vector<std::pair<double, int>> heap;
+
+    void reset(size_t nodeCount) {
+        cost.assign(nodeCount, std::numeric_limits<double>::infinity());
+        next.assign(nodeCount, -1);
+        hopLine.assign(nodeCount, -1);
+        hopDistance.assign(nodeCount, 0);
+        hopTime.assign(nodeCount, 0);
+        otherTotal.assign(nodeCount, 0);
+        interchanges.assign(nodeCount, 0);
+        settled.assign(nodeCount, false);
+        settleOrder.clear();
+        heap.clear();
+    }
+
+    void push(int node, double nodeCost) {
+        heap.emplace_back(nodeCost, node);
+        std::push_heap(heap.begin(), heap.end(), std::greater<>());
+    }
+
+    // Next node to settle, or -1 when the search is done
+    int pop() {
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<>());
+            int node = heap.back().second;
+            heap.pop_back();
+            if (!settled[node]) {
+                settled[node] = true;
+                settleOrder.push_back(node);
+                return node;
+            }
+        }
+        return -1;
+    }
+};
+
+// Shortest distances from every station to one target, over stations
+static void buildDistanceColumn(const MetroGraph& graph, int targetIndex, RouteTableWorker& worker,
+                                RouteTableEntry* entries) {
+    int stationCount = graph.getStationCount();
+    worker.reset(stationCount);
+    worker.cost[targetIndex] = 0;
+    worker.push(targetIndex, 0);
+
+    for (int station = worker.pop(); station != -1; station = worker.pop()) {
+        double stationCost = worker.cost[station];
+        for (int state = graph.getFirstState(station); state < graph.getEndState(station); state++) {
+            for (const ReverseCsrEdge& edge : graph.getReverseEdges(state)) {
+                double cost = stationCost + edge.distance;
+                if (cost < worker.cost[edge.sourceIndex]) {
+                    worker.cost[edge.sourceIndex] = cost;
+                    worker.next[edge.sourceIndex] = station;
+                    worker.hopLine[edge.sourceIndex] = graph.getStateLine(state);
+                    worker.hopTime[edge.sourceIndex] = edge.time;
+                    worker.push(edge.sourceIndex, cost);
+                }
+            }
+        }
+    }
+
+    // Settle order puts every station after the one it continues to
+    for (int station : worker.settleOrder) {
+        int next = worker.next[station];
+        if (next < 0) {
+            continue;
+        }
+        worker.otherTotal[station] = worker.hopTime[station] + worker.otherTotal[next];
+        worker.interchanges[station] = worker.interchanges[next];
+        if (next != targetIndex && graph.isInterchangeAt(worker.hopLine[station], worker.hopLine[next])) {
+            worker.otherTotal[station] += INTERCHANGE_PENALTY_MINUTES;
+            worker.interchanges[station]++;
+        }
+    }
+
+    for (int source = 0; source < stationCount; source++) {
+        RouteTableEntry& entry = entries[static_cast<size_t>(source) * stationCount + targetIndex];
+        bool reached = worker.settled[source];
+        entry.distance = static_cast<float>(worker.cost[source]);
+        entry.time = reached ? static_cast<float>(worker.otherTotal[source]) : std::numeric_limits<float>::infinity();
+        entry.interchangeCount = static_cast<uint16_t>(worker.interchanges[source]);
+        entry.nextHop = worker.next[source] < 0 ? RouteTable::NO_HOP : static_cast<uint16_t>(worker.next[source]);
+    }
+}
+
+// Fastest times from every line-aware state to one target, then from every station
+static void buildTimeColumn(const MetroGraph& graph, int targetIndex, RouteTableWorker& worker,
+                            RouteTableEntry* entries, uint16_t* nextStates) {
+    int stationCount = graph.getStationCount();
+    int stateCount = graph.getStateCount();
+    worker.reset(stateCount);
+
+    // Arriving at the target on any line ends the trip
+    for (int state = graph.getFirstState(targetIndex); state < graph.getEndState(targetIndex); state++) {
+        worker.cost[state] = 0;
+        worker.push(state, 0);
+    }
+
+    for (int state = worker.pop(); state != -1; state = worker.pop()) {
+        double stateCost = worker.cost[state];
+        int line = graph.getStateLine(state);
+        for (const ReverseCsrEdge& edge : graph.getReverseEdges(state)) {
+            for (int prevState = graph.getFirstState(edge.sourceIndex);
+                 prevState < graph.getEndState(edge.sourceIndex); prevState++) {
+                double cost = stateCost + edge.time;
+                if (graph.isInterchangeAt(graph.getStateLine(prevState), line)) {
+                    cost += INTERCHANGE_PENALTY_MINUTES;
+                }
+                if (cost < worker.cost[prevState]) {
+                    worker.cost[prevState] = cost;
+                    worker.next[prevState] = state;
+                    worker.hopDistance[prevState] = edge.distance;
+                    worker.push(prevState, cost);
+                }
+            }
+        }
+    }
+
+    for (int state : worker.settleOrder) {
+        int next = worker.next[state];
+        if (next < 0) {
+            continue;
+        }
+        worker.otherTotal[state] = worker.hopDistance[state] + worker.otherTotal[next];
+        worker.interchanges[state] = worker.interchanges[next] +
+            (graph.isInterchangeAt(graph.getStateLine(state), graph.getStateLine(next)) ? 1 : 0);
+    }
+
+    for (int state = 0; state < stateCount; state++) {
+        int next = worker.next[state];
+        nextStates[static_cast<size_t>(state) * stationCount + targetIndex] =
+            next < 0 ? RouteTable::NO_HOP : static_cast<uint16_t>(next);
+    }
+
+    // The first ride from a station never pays an interchange penalty
+    for (int source = 0; source < stationCount; source++) {
+        double bestTime = std::numeric_limits<double>::infinity();
+        double bestDistance = std::numeric_limits<double>::infinity();
+        int firstState = -1;
+        if (source != targetIndex) {
+            for (const CsrEdge& edge : graph.getEdges(source)) {
+                int state = graph.getEdgeTargetState(graph.getEdgeIndex(edge));
+                double time = edge.time + worker.cost[state];
+                if (time < bestTime) {
+                    bestTime = time;
+                    bestDistance = edge.distance + worker.otherTotal[state];
+                    firstState = state;
+                }
+            }
+        } else {
+            bestTime = 0;
+            bestDistance = 0;
+        }
+
+        RouteTableEntry& entry = entries[static_cast<size_t>(source) * stationCount + targetIndex];
+        entry.distance = static_cast<float>(bestDistance);
+        entry.time = static_cast<float>(bestTime);
+        entry.interchangeCount = static_cast<uint16_t>(firstState < 0 ? 0 : worker.interchanges[firstState]);
+        entry.nextHop = firstState < 0 ? RouteTable::NO_HOP : static_cast<uint16_t>(firstState);
+    }
+}
+
+std::vector<uint8_t> RouteTable::build(const MetroGraph& graph, unsigned threadCount) {
+    size_t stationCount = static_cast<size_t>(graph.getStationCount());
+    size_t stateCount = static_cast<size_t>(graph.getStateCount());
+    if (!graph.isFrozen() || stationCount >= NO_HOP || stateCount >= NO_HOP) {
+        return std::vector<uint8_t>();
+    }
+
+    std::vector<uint8_t> blob(blobSize(stationCount, stateCount));
+    RouteTableHeader header;
+    std::memcpy(header.magic, ROUTE_TABLE_MAGIC, sizeof(header.magic));
+    header.version = FORMAT_VERSION;
+    header.graphFingerprint = graph.getFingerprint();
+    header.stationCount = static_cast<uint32_t>(stationCount);
+    header.stateCount = static_cast<uint32_t>(stateCount);
+    std::memcpy(blob.data(), &header, sizeof(header));
+
+    RouteTableEntry* distanceEntries = reinterpret_cast<RouteTableEntry*>(blob.data() + sizeof(RouteTableHeader));
+    RouteTableEntry* timeEntries = distanceEntries + stationCount * stationCount;
+    uint16_t* nextStates = reinterpret_cast<uint16_t*>(timeEntries + stationCount * stationCount);
+
+    // Each target is one column of every table, so tasks never write the same entry
+    TaskPool::shared().run(stationCount, [&](size_t target) {
+        thread_local RouteTableWorker worker;
+        buildDistanceColumn(graph, static_cast<int>(target), worker, distanceEntries);
+        buildTimeColumn(graph, static_cast<int>(target), worker, timeEntries, nextStates);
+    }, threadCount);
+
+    return blob;
+}
+
+bool RouteTable::writeToFile(const std::vector<uint8_t>& blob, const std::string& path) {
+    std::string tempPath = path + ".tmp";
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = fwrite(blob.data(), 1, blob.size(), file) == blob.size();
+    written = fclose(file) == 0 && written;
+    if (!written || rename(tempPath.c_str(), path.c_str()) != 0) {
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool RouteTable::attach(const uint8_t* data, size_t size, const MetroGraph& graph) {
+    if (!graph.isFrozen() || size < sizeof(RouteTableHeader)) {
+        return false;
+    }
+
+    RouteTableHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, ROUTE_TABLE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != FORMAT_VERSION ||
+        header.graphFingerprint != graph.getFingerprint() ||
+        header.stationCount != static_cast<uint32_t>(graph.getStationCount()) ||
+        header.stateCount != static_cast<uint32_t>(graph.getStateCount()) ||
+        size != blobSize(header.stationCount, header.stateCount)) {
+        return false;
+    }
+
+    stationCount = static_cast<int>(header.stationCount);
+    size_t entryCount = static_cast<size_t>(stationCount) * stationCount;
+    distanceEntries = reinterpret_cast<const RouteTableEntry*>(data + sizeof(RouteTableHeader));
+    timeEntries = distanceEntries + entryCount;
+    nextStates = reinterpret_cast<const uint16_t*>(timeEntries + entryCount);
+    return true;
+}
+
+bool RouteTable::loadFromBuffer(std::vector<uint8_t> blob, const MetroGraph& graph) {
+    release();
+    ownedData = std::move(blob);
+    if (!attach(ownedData.data(), ownedData.size(), graph)) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+bool RouteTable::loadFromFile(const std::string& path, const MetroGraph& graph) {
+    release();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    size_t size = static_cast<size_t>(fileStat.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    mappedData = data;
+    mappedSize = size;
+
+    if (!attach(static_cast<const uint8_t*>(data), size, graph)) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+void RouteTable::release() {
+    if (mappedData) {
+        munmap(mappedData, mappedSize);
+        mappedData = nullptr;
+        mappedSize = 0;
+    }
+    std::vector<uint8_t>().swap(ownedData);
+    stationCount = 0;
+    distanceEntries = nullptr;
+    timeEntries = nullptr;
+    nextStates = nullptr;
+}
+
+RouteTable::~RouteTable() {
+    release();
+}
@@ -0,0 +1,89 @@
+#ifndef ROUTE_TABLE_H
+#define ROUTE_TABLE_H
+
+#include "metro_graph.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Best route between two stations for one metric, as stored in the route table
+struct RouteTableEntry {
+    float distance;             // Distance in km
+    float time;                 // Time in minutes, including interchange penalties
+    uint16_t interchangeCount;
+    uint16_t nextHop;           // Next station (distance) or first state (time); RouteTable::NO_HOP if none
+};
+
+// Header of a serialized route table. The blob is native-endian and laid out as
+// header, distance entries [source][target], time entries [source][target], then
+// for time routes the next state [state][target] (uint16_t), so it can be used
+// straight from an mmap'ed file.
+struct RouteTableHeader {
+    char magic[4];              // "MRTB"
+    uint32_t version;
+    uint64_t graphFingerprint;  // MetroGraph::getFingerprint() of the graph it was built from
+    uint32_t stationCount;
+    uint32_t stateCount;
+};
+
+// All-pairs route table for both metrics over a frozen MetroGraph. Distance routes
+// follow next stations; time routes follow line-aware states, since the best way on
+// depends on the line a station was reached by.
+class RouteTable {
+private:
+    // Blob in use: either an mmap'ed file or an owned buffer
+    void* mappedData = nullptr;
+    size_t mappedSize = 0;
+    std::vector<uint8_t> ownedData;
+
+    int stationCount = 0;
+    const RouteTableEntry* distanceEntries = nullptr;
+    const RouteTableEntry* timeEntries = nullptr;
+    const uint16_t* nextStates = nullptr;
+
+    // Check a blob against the graph and point the accessors into it
+    bool attach(const uint8_t* data, size_t size, const MetroGraph& graph);
+
+    // Drop the current blob
+    void release();
+
+public:
+    static const uint32_t FORMAT_VERSION = 1;
+    static const uint16_t NO_HOP = 0xFFFF;
+
+    RouteTable() = default;
+    ~RouteTable();
+    RouteTable(const RouteTable&) = delete;
+    RouteTable& operator=(const RouteTable&) = delete;
+
+    // Compute the tables for a frozen graph, one target per task on the shared TaskPool
+    // with at most threadCount threads including the caller (0 = every worker); returns
+    // the serialized blob, empty if the graph is too large for 16-bit hops. An exception
+    // from a task is rethrown here
+    static std::vector<uint8_t> build(const MetroGraph& graph, unsigned threadCount = 0);
+
+    // Write a blob atomically (temporary file, then rename)
+    static bool writeToFile(const std::vector<uint8_t>& blob, const std::string& path);
+
+    // Use a blob built for this graph; false if it is malformed, of another version or stale
+    bool loadFromBuffer(std::vector<uint8_t> blob, const MetroGraph& graph);
+
+    // Map a blob file read-only; false if missing, malformed, of another version or stale
+    bool loadFromFile(const std::string& path, const MetroGraph& graph);
+
+    bool isLoaded() const { return distanceEntries != nullptr; }
+
+    // Route between two dense station indices
+    const RouteTableEntry& getEntry(bool useDistance, int sourceIndex, int targetIndex) const {
+        const RouteTableEntry* entries = useDistance ? distanceEntries : timeEntries;
+        return entries[static_cast<size_t>(sourceIndex) * stationCount + targetIndex];
+    }
+
+    // State after a line-aware state on the fastest way to a station; NO_HOP once there
+    int getNextState(int state, int targetIndex) const {
+        return nextStates[static_cast<size_t>(state) * stationCount + targetIndex];
+    }
+};
+
+#endif // ROUTE_TABLE_H
@@ -0,0 +1,56 @@
+#include "station_grid.h"
+#include <algorithm>
+#include <cmath>
+
+StationGrid::StationGrid(const std::vector<const MetroStation*>& stations, double cellSize)
+    : cellSizeKm(cellSize > 0 ? cellSize : 1.0) {
+    // Longitude is scaled at the latitude farthest from the equator, where degrees are
+    // shortest, so at city scale projected offsets stay within ground distances and the
+    // cells around a point cover its whole radius
+    double maxLatitude = 0;
+    for (const MetroStation* station : stations) {
+        maxLatitude = std::max(maxLatitude, std::fabs(station->latitude));
+    }
+    kmPerDegreeLat = 6371.0 * M_PI / 180.0;
+    kmPerDegreeLon = kmPerDegreeLat * std::cos(std::min(maxLatitude, 89.0) * M_PI / 180.0);
+
+    entries.reserve(stations.size());
+    for (const MetroStation* station : stations) {
+        entries.push_back(Entry{cellKey(cellRow(station->latitude), cellColumn(station->longitude)), station});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.cell < b.cell || (a.cell == b.cell && a.station->id < b.station->id);
+    });
+}
+
+int StationGrid::cellRow(double latitude) const {
+    return static_cast<int>(std::floor(latitude * kmPerDegreeLat / cellSizeKm));
+}
+
+int StationGrid::cellColumn(double longitude) const {
+    return static_cast<int>(std::floor(longitude * kmPerDegreeLon / cellSizeKm));
+}
+
+void StationGrid::findWithin(double latitude, double longitude, double radiusKm,
+                             std::vector<const MetroStation*>& out) const {
+    if (!(radiusKm >= 0)) {
+        return;
+    }
+    int reach = static_cast<int>(std::ceil(radiusKm / cellSizeKm));
+    int row = cellRow(latitude);
+    int column = cellColumn(longitude);
+    auto byCell = [](const Entry& entry, uint64_t cell) { return entry.cell < cell; };
+
+    for (int r = row - reach; r <= row + reach; r++) {
+        for (int c = column - reach; c <= column + reach; c++) {
+            uint64_t cell = cellKey(r, c);
+            for (auto it = std::lower_bound(entries.begin(), entries.end(), cell, byCell);
+                 it != entries.end() && it->cell == cell; ++it) {
+                const MetroStation* station = it->station;
+                if (haversineDistance(latitude, longitude, station->latitude, station->longitude) <= radiusKm) {
+                    out.push_back(station);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef STATION_GRID_H
+#define STATION_GRID_H
+
+#include "metro_graph.h"
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over station coordinates for radius queries. Stations are projected
+// onto a flat plane in km and bucketed into square cells, so a query only measures
+// the stations in the cells around the point instead of every station.
+class StationGrid {
+private:
+    struct Entry {
+        uint64_t cell;
+        const MetroStation* station;
+    };
+
+    double cellSizeKm;
+    double kmPerDegreeLat;
+    double kmPerDegreeLon;
+    std::vector<Entry> entries;   // sorted by cell
+
+    int cellRow(double latitude) const;
+    int cellColumn(double longitude) const;
+
+    static uint64_t cellKey(int row, int column) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(row)) << 32) | static_cast<uint32_t>(column);
+    }
+
+public:
+    // Index the given stations (they must outlive the grid) in cells of cellSizeKm;
+    // queries are cheapest when the cell size is close to the usual radius
+    StationGrid(const std::vector<const MetroStation*>& stations, double cellSizeKm);
+
+    // Append the stations within radiusKm (great-circle) of a point to out
+    void findWithin(double latitude, double longitude, double radiusKm,
+                    std::vector<const MetroStation*>& out) const;
+
+    size_t size() const { return entries.size(); }
+};
+
+#endif // STATION_GRID_H
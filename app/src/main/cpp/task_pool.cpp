@@ -0,0 +1,100 @@
+#include "task_pool.h"
+#include <algorithm>
+
+TaskPool::TaskPool(unsigned workerCount) {
+    for (unsigned i = 0; i < workerCount; i++) {
+        workers.emplace_back(&TaskPool::workerLoop, this);
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+TaskPool& TaskPool::shared() {
+    // Never destroyed, so no worker is joined while static destructors run at exit
+    static TaskPool* pool = new TaskPool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return *pool;
+}
+
+void TaskPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        // Help the oldest batch with tasks left and room for another worker
+        auto found = std::find_if(batches.begin(), batches.end(), [](const Batch* batch) {
+            return batch->nextTask < batch->taskCount && batch->helpers < batch->helperLimit;
+        });
+        if (found == batches.end()) {
+            if (stopping) {
+                return;
+            }
+            workAvailable.wait(lock);
+            continue;
+        }
+        Batch& batch = **found;
+        batch.helpers++;
+        runTasks(batch, lock);
+        batch.helpers--;
+        if (batch.doneTasks == batch.taskCount && batch.helpers == 0) {
+            batchDone.notify_all();
+        }
+    }
+}
+
+void TaskPool::runTasks(Batch& batch, std::unique_lock<std::mutex>& lock) {
+    while (batch.nextTask < batch.taskCount) {
+        size_t task = batch.nextTask++;
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+            (*batch.task)(task);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+        batch.errors[task] = error;
+        batch.doneTasks++;
+    }
+}
+
+void TaskPool::run(size_t taskCount, const std::function<void(size_t)>& task, unsigned threadCount) {
+    if (taskCount == 0) {
+        return;
+    }
+    unsigned helperLimit = threadCount == 0 ? getWorkerCount() : std::min(threadCount - 1, getWorkerCount());
+    helperLimit = static_cast<unsigned>(std::min<size_t>(helperLimit, taskCount - 1));
+    
+    // Each task keeps its own exception, so which one is rethrown doesn't depend on timing
+    Batch batch{taskCount, &task, helperLimit, 0, 0, 0, std::vector<std::exception_ptr>(taskCount)};
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    if (helperLimit > 0) {
+        batches.push_back(&batch);
+        workAvailable.notify_all();
+    }
+    runTasks(batch, lock);
+    
+    // Workers still on the batch hold a reference to it until they leave
+    batchDone.wait(lock, [&batch] { return batch.doneTasks == batch.taskCount && batch.helpers == 0; });
+    if (helperLimit > 0) {
+        batches.erase(std::find(batches.begin(), batches.end(), &batch));
+    }
+    lock.unlock();
+    
+    for (const std::exception_ptr& error : batch.errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+void TaskPool::run(const std::vector<std::function<void()>>& tasks, unsigned threadCount) {
+    run(tasks.size(), [&tasks](size_t task) { tasks[task](); }, threadCount);
+}
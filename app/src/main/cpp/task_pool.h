@@ -0,0 +1,64 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run batches of tasks. The workers start once and
+// sleep between batches, so code that fans out often (each batch of a file, each
+// matrix query) doesn't start and join threads every time. The calling thread works
+// through its own batch as well, so a batch finishes even when every worker is busy
+// with another caller's.
+class TaskPool {
+private:
+    // A run() in progress; lives on its caller's stack
+    struct Batch {
+        size_t taskCount;
+        const std::function<void(size_t)>* task;
+        unsigned helperLimit;       // workers allowed on the batch at once
+        unsigned helpers = 0;       // workers on it now
+        size_t nextTask = 0;
+        size_t doneTasks = 0;
+        std::vector<std::exception_ptr> errors;   // by task
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable batchDone;
+    std::deque<Batch*> batches;
+    bool stopping = false;
+
+    void workerLoop();
+
+    // Run tasks of batch until none are left to start; lock is held between tasks
+    void runTasks(Batch& batch, std::unique_lock<std::mutex>& lock);
+
+public:
+    // Start workerCount workers
+    explicit TaskPool(unsigned workerCount);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    unsigned getWorkerCount() const { return static_cast<unsigned>(workers.size()); }
+
+    // Run task(0) to task(taskCount - 1) on up to threadCount threads, the calling one
+    // included (0 = the caller and every worker), and return once all are done. Then
+    // rethrow the exception of the first task that failed, in task order
+    void run(size_t taskCount, const std::function<void(size_t)>& task, unsigned threadCount = 0);
+    void run(const std::vector<std::function<void()>>& tasks, unsigned threadCount = 0);
+
+    // Pool shared by the whole library: one worker per core besides the caller's,
+    // started on first use
+    static TaskPool& shared();
+};
+
+#endif // TASK_POOL_H
@@ -0,0 +1,47 @@
+#ifndef TIMETABLE_H
+#define TIMETABLE_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Engines answering earliest-arrival queries over the timetable
+enum class TimetableEngine {
+    Raptor = 0,                 // Round-based, bounded number of trains
+    ConnectionScan = 1          // Single sweep over connections sorted by departure
+};
+
+// Service calendar from calendar.txt
+struct TimetableService {
+    std::string id;
+    uint8_t weekdays;           // Bit 0 = Monday ... bit 6 = Sunday
+    int startDate;              // YYYYMMDD
+    int endDate;                // YYYYMMDD
+
+    TimetableService(std::string id, uint8_t weekdays, int startDate, int endDate)
+        : id(std::move(id)), weekdays(weekdays), startDate(startDate), endDate(endDate) {}
+};
+
+// One scheduled trip with its stops in sequence order; times are seconds after
+// midnight of the service day and may go past 24:00:00
+struct TimetableTrip {
+    int routeId;
+    int serviceIndex;           // Index into Timetable::services, -1 if unknown
+    std::vector<int> stopIds;
+    std::vector<int> arrivalTimes;
+    std::vector<int> departureTimes;
+};
+
+// Trips and calendars kept from the GTFS feed for the timetable engines
+struct Timetable {
+    std::vector<TimetableService> services;
+    std::vector<TimetableTrip> trips;
+
+    void clear() {
+        services.clear();
+        trips.clear();
+    }
+};
+
+#endif // TIMETABLE_H
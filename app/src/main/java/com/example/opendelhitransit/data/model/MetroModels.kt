@@ -29,8 +29,22 @@ data class MetroPath(
     val interchanges: List<String> = listOf(),
     val distance: Double = 0.0,
     val time: Double = 0.0,
-    val interchangeCount: Int = 0
+    val interchangeCount: Int = 0,
+    val sourceStationId: Int = -1, // Stop_id the path starts from, the one chosen among name matches
+    val targetStationId: Int = -1 // Stop_id the path ends at
 ) {
 
     fun isValid(): Boolean = stations.size >= 2
-} 
\ No newline at end of file
+} 
+
+/**
+ * Fastest travel times from one station, as parallel arrays ordered by time
+ */
+class StationTravelTimes(
+    val stationIds: IntArray = IntArray(0),
+    val times: FloatArray = FloatArray(0), // Minutes, including interchange penalties
+    val distances: FloatArray = FloatArray(0) // Km along each fastest path
+) {
+
+    val size: Int get() = stationIds.size
+}
@@ -3,6 +3,7 @@ package com.example.opendelhitransit.data.native
 import android.content.res.AssetManager
 import android.util.Log
 import com.example.opendelhitransit.data.model.MetroPath
+import com.example.opendelhitransit.data.model.StationTravelTimes
 
 /**
  * Native library interface for Delhi Metro pathfinding algorithms.
@@ -12,6 +13,30 @@ class MetroNativeLib {
     companion object {
         private const val TAG = "MetroNativeLib"
         
+        // Search algorithms understood by setSearchAlgorithmNative
+        const val SEARCH_DIJKSTRA = 0
+        const val SEARCH_A_STAR = 1
+        const val SEARCH_BIDIRECTIONAL = 2
+        const val SEARCH_CONTRACTION_HIERARCHY = 3
+        const val SEARCH_ROUTE_TABLE = 4
+        
+        // Timetable engines understood by setTimetableEngineNative
+        const val TIMETABLE_RAPTOR = 0
+        const val TIMETABLE_CONNECTION_SCAN = 1
+        
+        // Matrix modes understood by computeMatrixNative
+        const val MATRIX_DISTANCE = 0
+        const val MATRIX_TIME = 1
+        
+        // Interchange weight used by findAccessiblePath by default (AccessibleTimeCost)
+        const val DEFAULT_ACCESSIBLE_INTERCHANGE_MINUTES = 30.0
+        
+        // Walking links between nearby stations made by setFootpaths() without
+        // arguments; there are none until it is called
+        const val DEFAULT_FOOTPATH_RADIUS_KM = 0.5
+        const val DEFAULT_WALKING_SPEED_KMH = 5.0
+        const val DEFAULT_FOOTPATH_PENALTY_MINUTES = 5.0
+        
         // Load the native library
         init {
             System.loadLibrary("metro_path_finder")
@@ -22,9 +47,12 @@ class MetroNativeLib {
     /**
      * Initialize the metro graph with data from the GTFS files
      * @param assetManager Asset manager to access GTFS files
+     * @param snapshotPath File for a binary snapshot of the parsed graph (e.g. under
+     * filesDir): loaded instead of parsing while it matches the assets, written after a
+     * parse otherwise; null to always parse
      * @return true if initialization successful, false otherwise
      */
-    external fun initMetroGraphNative(assetManager: AssetManager): Boolean
+    external fun initMetroGraphNative(assetManager: AssetManager, snapshotPath: String?): Boolean
     
     /**
      * Find the shortest path between two stations by their IDs
@@ -42,6 +70,60 @@ class MetroNativeLib {
      */
     external fun findFastestPathNative(sourceId: Int, targetId: Int): MetroPath?
     
+    /**
+     * Find the fastest path for riders who find changing lines hard
+     * @param sourceId Source station ID
+     * @param targetId Target station ID
+     * @param interchangeMinutes Weight of each interchange in the search; totals report real time
+     * @return MetroPath object containing the path details
+     */
+    external fun findAccessiblePathNative(sourceId: Int, targetId: Int, interchangeMinutes: Double): MetroPath?
+    
+    /**
+     * Find the fastest times from one station to every station in a single search
+     * @param sourceId Source station ID
+     * @param maxMinutes Time budget; stations slower to reach are left out
+     * @return StationTravelTimes ordered by time, starting with the source
+     */
+    external fun findTravelTimesNative(sourceId: Int, maxMinutes: Double): StationTravelTimes?
+    
+    /**
+     * Compute the cost from every source to every target in one call
+     * @param sources Source station IDs
+     * @param targets Target station IDs
+     * @param mode MATRIX_DISTANCE (km) or MATRIX_TIME (minutes)
+     * @return Costs row-major, sources.size * targets.size; unreachable pairs are infinity
+     */
+    external fun computeMatrixNative(sources: IntArray, targets: IntArray, mode: Int): FloatArray?
+    
+    /**
+     * Find the earliest arrival by scheduled trains between two stations by their IDs
+     * @param sourceId Source station ID
+     * @param targetId Target station ID
+     * @param departureTime Departure time in seconds after midnight
+     * @param dayOfWeek Day of the week, 0 = Monday ... 6 = Sunday
+     * @return MetroPath object whose totalTime runs from departure to arrival, empty if unreachable
+     */
+    external fun findEarliestArrivalNative(sourceId: Int, targetId: Int, departureTime: Int, dayOfWeek: Int): MetroPath?
+    
+    /**
+     * Find all non-dominated paths over time, interchanges and distance by station IDs
+     * @param sourceId Source station ID
+     * @param targetId Target station ID
+     * @return MetroPath alternatives, fastest first; empty if unreachable
+     */
+    external fun findParetoPathsNative(sourceId: Int, targetId: Int): Array<MetroPath>?
+    
+    /**
+     * Find alternative routes between two stations by their IDs
+     * @param sourceId Source station ID
+     * @param targetId Target station ID
+     * @param count Maximum number of routes
+     * @param useDistance Rank by distance instead of time
+     * @return Loopless MetroPaths that don't mostly share line segments, cheapest first
+     */
+    external fun findAlternativePathsNative(sourceId: Int, targetId: Int, count: Int, useDistance: Boolean): Array<MetroPath>?
+    
     /**
      * Find the shortest path between two stations by their names
      * @param sourceName Source station name
@@ -64,6 +146,87 @@ class MetroNativeLib {
      */
     external fun getAllStationNamesNative(): Array<String>
     
+    /**
+     * Select the search algorithm used for path queries
+     * @param algorithm One of the SEARCH_* constants
+     * @return true if the algorithm is supported
+     */
+    external fun setSearchAlgorithmNative(algorithm: Int): Boolean
+    
+    /**
+     * Select the engine used by findEarliestArrivalNative
+     * @param engine One of the TIMETABLE_* constants
+     * @return true if the engine is supported
+     */
+    external fun setTimetableEngineNative(engine: Int): Boolean
+    
+    /**
+     * Set the walking links added between nearby stations; takes effect on the next
+     * initMetroGraphNative. Walks show up in paths on the line "Walk".
+     * @param radiusKm Longest walk between two stations in km (0 disables walking)
+     * @param walkingSpeedKmh Walking speed in km/h
+     * @param penaltyMinutes Minutes added to every walk for leaving and entering stations
+     * @return true if the settings are valid
+     */
+    external fun setFootpathsNative(radiusKm: Double, walkingSpeedKmh: Double, penaltyMinutes: Double): Boolean
+    
+    /**
+     * Close or reopen a station; path queries avoid closed stations
+     * @param stationId Station ID
+     * @param closed true to close, false to reopen
+     * @return true if the station is known
+     */
+    external fun setStationClosedNative(stationId: Int, closed: Boolean): Boolean
+    
+    /**
+     * Close or reopen a whole line
+     * @param lineId Line ID
+     * @param closed true to close, false to reopen
+     * @return true if the line is known
+     */
+    external fun setLineClosedNative(lineId: Int, closed: Boolean): Boolean
+    
+    /**
+     * Close or reopen the track between two adjacent stations, in both directions
+     * @param stationIdA One end of the segment
+     * @param stationIdB Other end of the segment
+     * @param closed true to close, false to reopen
+     * @return true if both stations are known
+     */
+    external fun setSegmentClosedNative(stationIdA: Int, stationIdB: Int, closed: Boolean): Boolean
+    
+    /**
+     * Multiply the ride times of a line, e.g. 1.5 for delays; 1.0 restores the schedule
+     * @param lineId Line ID
+     * @param factor Positive time factor
+     * @return true if the line is known and the factor valid
+     */
+    external fun setLineTimeScaleNative(lineId: Int, factor: Double): Boolean
+    
+    /**
+     * Multiply the ride times between two adjacent stations, in both directions
+     * @param stationIdA One end of the segment
+     * @param stationIdB Other end of the segment
+     * @param factor Positive time factor
+     * @return true if both stations are known and the factor valid
+     */
+    external fun setSegmentTimeScaleNative(stationIdA: Int, stationIdB: Int, factor: Double): Boolean
+    
+    /**
+     * Reopen everything and restore all ride times
+     */
+    external fun clearDisruptionsNative()
+    
+    /**
+     * Load the all-pairs route table used by SEARCH_ROUTE_TABLE: maps the cached
+     * file if it matches the graph, else uses a copy shipped in assets, else
+     * builds the table and writes it to the cache file
+     * @param assetManager Asset manager to look for a shipped table
+     * @param cachePath File path for the cached table (e.g. under cacheDir)
+     * @return true if a table is ready
+     */
+    external fun loadRouteTableNative(assetManager: AssetManager, cachePath: String): Boolean
+    
     /**
      * Release native resources
      */
@@ -74,8 +237,8 @@ class MetroNativeLib {
     /**
      * Initialize the metro graph
      */
-    fun initMetroGraph(assetManager: AssetManager): Boolean {
-        return initMetroGraphNative(assetManager)
+    fun initMetroGraph(assetManager: AssetManager, snapshotPath: String? = null): Boolean {
+        return initMetroGraphNative(assetManager, snapshotPath)
     }
     
     /**
@@ -92,6 +255,56 @@ class MetroNativeLib {
         return findFastestPathNative(sourceId, targetId)
     }
     
+    /**
+     * Find the fastest path weighting each interchange as interchangeMinutes
+     */
+    fun findAccessiblePath(sourceId: Int, targetId: Int,
+                           interchangeMinutes: Double = DEFAULT_ACCESSIBLE_INTERCHANGE_MINUTES): MetroPath? {
+        return findAccessiblePathNative(sourceId, targetId, interchangeMinutes)
+    }
+    
+    /**
+     * Find travel times from a station to the whole network
+     */
+    fun findTravelTimes(sourceId: Int): StationTravelTimes? {
+        return findTravelTimesNative(sourceId, Double.POSITIVE_INFINITY)
+    }
+    
+    /**
+     * Find the stations reachable from a station within a time budget in minutes
+     */
+    fun findIsochrone(sourceId: Int, maxMinutes: Double): StationTravelTimes? {
+        return findTravelTimesNative(sourceId, maxMinutes)
+    }
+    
+    /**
+     * Compute an origin-destination matrix, cost of sources[i] to targets[j] at i * targets.size + j
+     */
+    fun computeMatrix(sources: IntArray, targets: IntArray, mode: Int): FloatArray? {
+        return computeMatrixNative(sources, targets, mode)
+    }
+    
+    /**
+     * Find earliest arrival by scheduled trains by station IDs
+     */
+    fun findEarliestArrival(sourceId: Int, targetId: Int, departureTime: Int, dayOfWeek: Int): MetroPath? {
+        return findEarliestArrivalNative(sourceId, targetId, departureTime, dayOfWeek)
+    }
+    
+    /**
+     * Find all non-dominated paths by station IDs
+     */
+    fun findParetoPaths(sourceId: Int, targetId: Int): Array<MetroPath>? {
+        return findParetoPathsNative(sourceId, targetId)
+    }
+    
+    /**
+     * Find alternative routes by station IDs
+     */
+    fun findAlternativePaths(sourceId: Int, targetId: Int, count: Int, useDistance: Boolean): Array<MetroPath>? {
+        return findAlternativePathsNative(sourceId, targetId, count, useDistance)
+    }
+    
     /**
      * Find shortest path by station names
      */
@@ -113,6 +326,79 @@ class MetroNativeLib {
         return getAllStationNamesNative()
     }
     
+    /**
+     * Select the search algorithm for path queries
+     */
+    fun setSearchAlgorithm(algorithm: Int): Boolean {
+        return setSearchAlgorithmNative(algorithm)
+    }
+    
+    /**
+     * Select the timetable engine
+     */
+    fun setTimetableEngine(engine: Int): Boolean {
+        return setTimetableEngineNative(engine)
+    }
+    
+    /**
+     * Set the walking links between nearby stations (there are none until this is
+     * called; a radius of 0 turns them off again)
+     */
+    fun setFootpaths(radiusKm: Double = DEFAULT_FOOTPATH_RADIUS_KM,
+                     walkingSpeedKmh: Double = DEFAULT_WALKING_SPEED_KMH,
+                     penaltyMinutes: Double = DEFAULT_FOOTPATH_PENALTY_MINUTES): Boolean {
+        return setFootpathsNative(radiusKm, walkingSpeedKmh, penaltyMinutes)
+    }
+    
+    /**
+     * Close or reopen a station
+     */
+    fun setStationClosed(stationId: Int, closed: Boolean): Boolean {
+        return setStationClosedNative(stationId, closed)
+    }
+    
+    /**
+     * Close or reopen a line
+     */
+    fun setLineClosed(lineId: Int, closed: Boolean): Boolean {
+        return setLineClosedNative(lineId, closed)
+    }
+    
+    /**
+     * Close or reopen the segment between two stations
+     */
+    fun setSegmentClosed(stationIdA: Int, stationIdB: Int, closed: Boolean): Boolean {
+        return setSegmentClosedNative(stationIdA, stationIdB, closed)
+    }
+    
+    /**
+     * Scale the ride times of a line
+     */
+    fun setLineTimeScale(lineId: Int, factor: Double): Boolean {
+        return setLineTimeScaleNative(lineId, factor)
+    }
+    
+    /**
+     * Scale the ride times between two stations
+     */
+    fun setSegmentTimeScale(stationIdA: Int, stationIdB: Int, factor: Double): Boolean {
+        return setSegmentTimeScaleNative(stationIdA, stationIdB, factor)
+    }
+    
+    /**
+     * Clear all closures and time factors
+     */
+    fun clearDisruptions() {
+        clearDisruptionsNative()
+    }
+    
+    /**
+     * Load or build the all-pairs route table
+     */
+    fun loadRouteTable(assetManager: AssetManager, cachePath: String): Boolean {
+        return loadRouteTableNative(assetManager, cachePath)
+    }
+    
     /**
      * Release resources
      */
@@ -10,6 +10,7 @@ import com.example.opendelhitransit.data.native.MetroNativeLib
 import dagger.hilt.android.qualifiers.ApplicationContext
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.withContext
+import java.io.File
 import javax.inject.Inject
 import javax.inject.Singleton
 
@@ -21,6 +22,11 @@ class MetroRepository @Inject constructor(@ApplicationContext private val contex
     private val metroNativeLib = MetroNativeLib()
     private val TAG = "MetroRepository"
     
+    /**
+     * Snapshot of the parsed graph in filesDir, so later starts skip the GTFS parse
+     */
+    private val GRAPH_SNAPSHOT_FILE = "metro_graph.bin"
+    
     /**
      * Maps station IDs to station objects for quick lookup
      */
@@ -37,7 +43,8 @@ class MetroRepository @Inject constructor(@ApplicationContext private val contex
     suspend fun initializeMetroGraph(assetManager: AssetManager): Boolean {
         return withContext(Dispatchers.IO) {
             try {
-                val result = metroNativeLib.initMetroGraph(assetManager)
+                val snapshotPath = File(context.filesDir, GRAPH_SNAPSHOT_FILE).path
+                val result = metroNativeLib.initMetroGraph(assetManager, snapshotPath)
                 Log.d(TAG, "Metro graph initialization result: $result")
                 result
             } catch (e: Exception) {
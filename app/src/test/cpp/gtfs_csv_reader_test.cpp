@@ -0,0 +1,99 @@
+#include "gtfs_csv_reader.h"
+#include "test_support.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static const size_t npos = std::string_view::npos;
+
+// Every record of a reader, fields joined by '|'
+static std::vector<std::string> readAll(GtfsCsvReader& reader, int columns) {
+    std::vector<std::string> records;
+    while (reader.next()) {
+        std::string record;
+        for (int column = 0; column < columns; column++) {
+            record += std::string(reader.getField(column)) + "|";
+        }
+        records.push_back(record);
+    }
+    return records;
+}
+
+// Record ends are found at a lone \r as well as at \n and \r\n
+static void testCarriageReturnRecordEnds() {
+    std::string_view data = "a,b\rc,d\re,f\r";
+    CHECK(GtfsCsvReader::findRecordEnd(data, 0) == 4);
+    CHECK(GtfsCsvReader::findRecordEnd(data, 5) == 8);
+    // The last \r may be followed by a \n not read yet
+    CHECK(GtfsCsvReader::findRecordEnd(data, 9) == npos);
+    CHECK(GtfsCsvReader::findLastRecordEnd(data) == 8);
+
+    std::string_view mixed = "a\r\nb\rc\nd";
+    CHECK(GtfsCsvReader::findRecordEnd(mixed, 0) == 3);
+    CHECK(GtfsCsvReader::findRecordEnd(mixed, 3) == 5);
+    CHECK(GtfsCsvReader::findLastRecordEnd(mixed) == 7);
+
+    // A \r inside quotes ends nothing
+    std::string_view quoted = "\"a\rb\",c\rd";
+    CHECK(GtfsCsvReader::findRecordEnd(quoted, 0) == 8);
+    CHECK(GtfsCsvReader::findLastRecordEnd(quoted) == 8);
+}
+
+// A file with \r line ends reads the same streamed in small chunks as from a buffer
+static void testStreamingCarriageReturns() {
+    std::string file = "stop_id,stop_name\r";
+    for (int i = 0; i < 200; i++) {
+        file += std::to_string(i) + ",Station " + std::to_string(i) + "\r";
+    }
+
+    GtfsCsvReader buffered(file);
+    std::vector<std::string> expected = readAll(buffered, 2);
+    CHECK(expected.size() == 200);
+
+    for (size_t chunkSize : {1, 2, 7, 64}) {
+        size_t offset = 0;
+        GtfsCsvReader streamed([&](char* buffer, size_t capacity) {
+            size_t count = std::min(capacity, file.size() - offset);
+            std::memcpy(buffer, file.data() + offset, count);
+            offset += count;
+            return count;
+        }, chunkSize);
+        CHECK(streamed.getColumn("stop_name") == 1);
+        CHECK(readAll(streamed, 2) == expected);
+    }
+}
+
+// Cut points follow the reader: a quote is only special at the start of a field
+static void testStrayQuoteRecordEnds() {
+    std::string data = "a,5\" gate\n\"x\ny\",b\nc,d\n";
+    CHECK(GtfsCsvReader::findRecordEnd(data, 0) == 10);
+    CHECK(GtfsCsvReader::findRecordEnd(data, 11) == 18);
+    CHECK(GtfsCsvReader::findRecordEnd(data, 11, 10) == 18);
+    CHECK(GtfsCsvReader::findLastRecordEnd(data) == data.size());
+    CHECK(GtfsCsvReader::findLastRecordEnd(data.substr(0, 17)) == 10);
+    CHECK(GtfsCsvReader::findLastRecordEnd(data, 10) == data.size());
+
+    // Each cut starts a shard that reads on as the whole buffer does
+    std::string file = "h1,h2\n" + data;
+    GtfsCsvReader whole(file);
+    std::vector<std::string> expected = readAll(whole, 2);
+    std::vector<std::string> sharded;
+    for (size_t start = 0; start < data.size();) {
+        size_t end = std::min(data.size(), GtfsCsvReader::findRecordEnd(data, start + 1, start));
+        GtfsCsvReader shard(std::string_view(data).substr(start, end - start), whole);
+        for (const std::string& record : readAll(shard, 2)) {
+            sharded.push_back(record);
+        }
+        start = end;
+    }
+    CHECK(sharded == expected);
+}
+
+int main() {
+    testCarriageReturnRecordEnds();
+    testStreamingCarriageReturns();
+    testStrayQuoteRecordEnds();
+    return testResult();
+}
@@ -0,0 +1,24 @@
+#ifndef HOST_ANDROID_ASSET_MANAGER_H
+#define HOST_ANDROID_ASSET_MANAGER_H
+
+#include <cstddef>
+#include <sys/types.h>
+
+// Host stand-in for the NDK asset API: an AAssetManager* is the path of a directory
+// (a const char*), and assets are the files under it
+struct AAssetManager;
+struct AAsset;
+
+enum {
+    AASSET_MODE_UNKNOWN = 0,
+    AASSET_MODE_RANDOM = 1,
+    AASSET_MODE_STREAMING = 2,
+    AASSET_MODE_BUFFER = 3
+};
+
+AAsset* AAssetManager_open(AAssetManager* manager, const char* filename, int mode);
+off_t AAsset_getLength(AAsset* asset);
+int AAsset_read(AAsset* asset, void* buffer, size_t count);
+void AAsset_close(AAsset* asset);
+
+#endif // HOST_ANDROID_ASSET_MANAGER_H
@@ -0,0 +1,7 @@
+#ifndef HOST_ANDROID_ASSET_MANAGER_JNI_H
+#define HOST_ANDROID_ASSET_MANAGER_JNI_H
+
+// Nothing on the host gets assets from Java
+#include "asset_manager.h"
+
+#endif // HOST_ANDROID_ASSET_MANAGER_JNI_H
@@ -0,0 +1,17 @@
+#ifndef HOST_ANDROID_LOG_H
+#define HOST_ANDROID_LOG_H
+
+#include <cstdio>
+
+// Host stand-in for the NDK log: messages go to stderr
+enum {
+    ANDROID_LOG_DEBUG = 3,
+    ANDROID_LOG_INFO = 4,
+    ANDROID_LOG_WARN = 5,
+    ANDROID_LOG_ERROR = 6
+};
+
+#define __android_log_print(priority, tag, ...) \
+    (std::fprintf(stderr, "[%s] ", tag), std::fprintf(stderr, __VA_ARGS__), std::fprintf(stderr, "\n"))
+
+#endif // HOST_ANDROID_LOG_H
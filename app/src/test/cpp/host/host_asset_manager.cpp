@@ -0,0 +1,33 @@
+#include <android/asset_manager.h>
+#include <cstdio>
+#include <string>
+
+struct AAsset {
+    FILE* file;
+    off_t length;
+};
+
+AAsset* AAssetManager_open(AAssetManager* manager, const char* filename, int /*mode*/) {
+    std::string path = std::string(reinterpret_cast<const char*>(manager)) + "/" + filename;
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return nullptr;
+    }
+    std::fseek(file, 0, SEEK_END);
+    off_t length = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    return new AAsset{file, length};
+}
+
+off_t AAsset_getLength(AAsset* asset) {
+    return asset->length;
+}
+
+int AAsset_read(AAsset* asset, void* buffer, size_t count) {
+    return static_cast<int>(std::fread(buffer, 1, count, asset->file));
+}
+
+void AAsset_close(AAsset* asset) {
+    std::fclose(asset->file);
+    delete asset;
+}
@@ -0,0 +1,244 @@
+#include "metro_data_parser.h"
+#include "metro_graph.h"
+#include "metro_path_finder.h"
+#include "test_support.h"
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Four stations about a kilometre apart, one route, one service
+static void writeNetwork(TestFeed& feed) {
+    feed.write("stops.txt",
+               "stop_id,stop_code,stop_name,stop_lat,stop_lon\n"
+               "1,A,Alpha,28.600,77.200\n"
+               "2,B,Bravo,28.610,77.200\n"
+               "3,C,Charlie,28.620,77.200\n"
+               "4,D,Delta,28.630,77.200\n");
+    feed.write("routes.txt",
+               "route_id,route_long_name,route_color\n"
+               "1,Red,FF0000\n");
+    feed.write("calendar.txt",
+               "service_id,monday,tuesday,wednesday,thursday,friday,saturday,sunday,start_date,end_date\n"
+               "WK,1,1,1,1,1,0,0,20240101,20251231\n");
+}
+
+// Edge of the parsed graph from sourceId to targetId on lineId, if there is one
+static bool findEdge(const MetroGraph& graph, int sourceId, int targetId, int lineId, MetroEdge& found) {
+    for (const MetroEdge& edge : graph.getNeighbors(sourceId)) {
+        if (edge.targetId == targetId && edge.lineId == lineId) {
+            found = edge;
+            return true;
+        }
+    }
+    return false;
+}
+
+// A malformed time leaves its stop untimed instead of failing the whole load
+static void testMalformedTime() {
+    TestFeed feed;
+    writeNetwork(feed);
+    feed.write("trips.txt",
+               "route_id,service_id,trip_id\n"
+               "1,WK,T1\n"
+               "1,WK,T2\n"
+               "1,WK,T3\n");
+    feed.write("stop_times.txt",
+               "trip_id,arrival_time,departure_time,stop_id,stop_sequence\n"
+               "T1,08:00:00,08:00:00,1,1\n"
+               "T1,08:02:00,08:02:30,2,2\n"
+               "T1,08:05:00,08:05:00,3,3\n"
+               "T2,09:00:00,09:00:00,1,1\n"
+               "T2,9x:02:00,09:02:30,2,2\n"
+               "T2,09:05:00,09:05:00,3,3\n"
+               "T3,10:00:00,10:00:00,2,1\n"
+               "T3,10:04:00,10:04:00,4,2\n");
+
+    MetroGraph graph;
+    Timetable timetable;
+    MetroDataParser parser(graph, feed.assets());
+    parser.setTimetable(&timetable);
+    parser.setFootpaths(0, MetroDataParser::DEFAULT_WALKING_SPEED_KM_PER_MINUTE, 0);
+    CHECK(parser.parseGTFSData());
+
+    // T2 still gives its stops, but not the run into the malformed arrival
+    MetroEdge edge(0, 0, 0, 0, 0);
+    CHECK(findEdge(graph, 1, 2, 1, edge));
+    CHECK(edge.timing.tripCount == 1);
+    CHECK(edge.timing.medianSeconds == 120);
+    CHECK(findEdge(graph, 2, 3, 1, edge));
+    CHECK(edge.timing.tripCount == 2);
+    CHECK(edge.timing.medianSeconds == 150);
+
+    // Trips after the bad row are read as usual
+    CHECK(findEdge(graph, 2, 4, 1, edge));
+    CHECK(edge.timing.tripCount == 1);
+    CHECK(edge.timing.medianSeconds == 240);
+
+    // Only fully timed trips reach the timetable
+    CHECK(timetable.trips.size() == 2);
+}
+
+// Each direction of a hop is timed by the trips running that way only
+static void testDirectedRunTimes() {
+    TestFeed feed;
+    writeNetwork(feed);
+    feed.write("routes.txt",
+               "route_id,route_long_name,route_color\n"
+               "1,Red,FF0000\n"
+               "2,Blue,0000FF\n");
+    feed.write("trips.txt",
+               "route_id,service_id,trip_id\n"
+               "1,WK,UP1\n"
+               "1,WK,UP2\n"
+               "1,WK,DOWN\n"
+               "2,WK,BACK\n");
+    feed.write("stop_times.txt",
+               "trip_id,arrival_time,departure_time,stop_id,stop_sequence\n"
+               "UP1,08:00:00,08:00:00,1,1\n"
+               "UP1,08:02:00,08:02:00,2,2\n"
+               "UP1,08:05:00,08:05:00,3,3\n"
+               "UP2,09:00:00,09:00:00,1,1\n"
+               "UP2,09:02:00,09:02:00,2,2\n"
+               "UP2,09:05:00,09:05:00,3,3\n"
+               "DOWN,10:00:00,10:00:00,2,1\n"
+               "DOWN,10:04:00,10:04:00,1,2\n"
+               "BACK,11:00:00,11:00:00,4,1\n"
+               "BACK,11:06:00,11:06:00,3,2\n"
+               "BACK,11:13:00,11:13:00,2,3\n");
+
+    MetroGraph graph;
+    MetroDataParser parser(graph, feed.assets());
+    CHECK(parser.parseGTFSData());
+
+    MetroEdge edge(0, 0, 0, 0, 0);
+    CHECK(findEdge(graph, 1, 2, 1, edge));
+    CHECK(edge.timing.tripCount == 2);
+    CHECK(edge.time == 2.0);
+    CHECK(findEdge(graph, 2, 1, 1, edge));
+    CHECK(edge.timing.tripCount == 1);
+    CHECK(edge.time == 4.0);
+
+    // Route 2 runs 3 -> 2, so route 1 gets no made-up edge that way, and route 2 none
+    // the other way, which route 1 runs
+    CHECK(!findEdge(graph, 3, 2, 1, edge));
+    CHECK(findEdge(graph, 3, 2, 2, edge));
+    CHECK(edge.time == 7.0);
+    CHECK(!findEdge(graph, 2, 3, 2, edge));
+
+    // No route runs 3 -> 4, so route 2's reverse hop stays, with the default time
+    CHECK(findEdge(graph, 3, 4, 2, edge));
+    CHECK(edge.timing.tripCount == 0);
+    CHECK(edge.time == MetroDataParser::DEFAULT_HOP_MINUTES);
+}
+
+// Two routes over the same stations in opposite directions: the fastest path rides
+// the route that runs the queried way, at its scheduled times
+static void testFastestPathFollowsDirection() {
+    TestFeed feed;
+    writeNetwork(feed);
+    feed.write("routes.txt",
+               "route_id,route_long_name,route_color\n"
+               "1,Red,FF0000\n"
+               "2,Blue,0000FF\n");
+    feed.write("trips.txt",
+               "route_id,service_id,trip_id\n"
+               "1,WK,UP\n"
+               "2,WK,DOWN\n");
+    feed.write("stop_times.txt",
+               "trip_id,arrival_time,departure_time,stop_id,stop_sequence\n"
+               "UP,08:00:00,08:00:00,1,1\n"
+               "UP,08:05:00,08:05:00,2,2\n"
+               "UP,08:10:00,08:10:00,3,3\n"
+               "UP,08:15:00,08:15:00,4,4\n"
+               "DOWN,09:00:00,09:00:00,4,1\n"
+               "DOWN,09:05:00,09:05:00,3,2\n"
+               "DOWN,09:10:00,09:10:00,2,3\n"
+               "DOWN,09:15:00,09:15:00,1,4\n");
+
+    MetroGraph graph;
+    MetroDataParser parser(graph, feed.assets());
+    CHECK(parser.parseGTFSData());
+    MetroPathFinder finder(graph);
+
+    MetroPath down = finder.findFastestPath(4, 1);
+    CHECK(down.totalTime == 15.0);
+    CHECK(down.lineIds == std::vector<int>(3, 2));
+    MetroPath up = finder.findFastestPath(1, 4);
+    CHECK(up.totalTime == 15.0);
+    CHECK(up.lineIds == std::vector<int>(3, 1));
+}
+
+// trips.txt and stop_times.txt for tripCount trips over stations 1 to 4, lines
+// ending with lineEnd; stop_times.txt comes out larger than one read batch. Each
+// row's headsign is written as given, except the one of trip strayQuoteTrip's first
+// stop, which has an unpaired quote in an unquoted field
+static void writeManyTrips(TestFeed& feed, int tripCount, const char* lineEnd, const char* headsign,
+                           int strayQuoteTrip = -1) {
+    std::string trips = std::string("route_id,service_id,trip_id") + lineEnd;
+    std::string stopTimes = std::string("trip_id,stop_headsign,arrival_time,departure_time,stop_id,stop_sequence") + lineEnd;
+    char row[128];
+    for (int trip = 0; trip < tripCount; trip++) {
+        trips += "1,WK,TRIP" + std::to_string(trip) + lineEnd;
+        int start = 5 * 3600 + trip % 1000 * 60;
+        for (int stop = 0; stop < 4; stop++) {
+            int time = start + stop * (120 + trip % 7 * 10);
+            std::snprintf(row, sizeof(row), "TRIP%d,%s,%02d:%02d:%02d,%02d:%02d:%02d,%d,%d%s", trip,
+                          trip == strayQuoteTrip && stop == 0 ? "Gate 5\" only" : headsign,
+                          time / 3600, time / 60 % 60, time % 60, time / 3600, time / 60 % 60, time % 60,
+                          stop + 1, stop + 1, lineEnd);
+            stopTimes += row;
+        }
+    }
+    feed.write("trips.txt", trips);
+    feed.write("stop_times.txt", stopTimes);
+}
+
+// Fingerprint of the graph and number of timed trips parsed from a feed
+static std::pair<uint64_t, size_t> parseFeed(const TestFeed& feed, unsigned threads) {
+    MetroGraph graph;
+    Timetable timetable;
+    MetroDataParser parser(graph, feed.assets());
+    parser.setTimetable(&timetable);
+    parser.setParseThreads(threads);
+    CHECK(parser.parseGTFSData());
+    return std::make_pair(graph.getFingerprint(), timetable.trips.size());
+}
+
+// stop_times.txt with \r line ends is cut into batches like one with \n line ends
+static void testCarriageReturnStopTimes() {
+    TestFeed newlines, returns;
+    writeNetwork(newlines);
+    writeNetwork(returns);
+    writeManyTrips(newlines, 30000, "\n", "Delta");
+    writeManyTrips(returns, 30000, "\r", "Delta");
+
+    auto expected = parseFeed(newlines, 1);
+    CHECK(expected.second == 30000);
+    CHECK(parseFeed(returns, 1) == expected);
+    CHECK(parseFeed(returns, 4) == expected);
+}
+
+// A quote inside an unquoted field is plain text to the reader, so it must not make
+// the shard and batch cuts take a line break in a later quoted field for a record end
+static void testStrayQuoteShards() {
+    TestFeed clean, stray;
+    writeNetwork(clean);
+    writeNetwork(stray);
+    writeManyTrips(clean, 10000, "\n", "\"To\nDelta\"");
+    writeManyTrips(stray, 10000, "\n", "\"To\nDelta\"", 3);
+
+    auto expected = parseFeed(clean, 1);
+    CHECK(expected.second == 10000);
+    CHECK(parseFeed(stray, 1) == expected);
+    CHECK(parseFeed(stray, 4) == expected);
+}
+
+int main() {
+    testMalformedTime();
+    testDirectedRunTimes();
+    testFastestPathFollowsDirection();
+    testCarriageReturnStopTimes();
+    testStrayQuoteShards();
+    return testResult();
+}
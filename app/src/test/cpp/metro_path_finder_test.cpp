@@ -0,0 +1,99 @@
+#include "metro_graph.h"
+#include "metro_path_finder.h"
+#include "route_table.h"
+#include "test_support.h"
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Small pseudo-random generator, so every run builds the same graphs
+class TestRandom {
+private:
+    uint32_t state;
+
+public:
+    explicit TestRandom(uint32_t seed) : state(seed) {}
+
+    uint32_t next() {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    }
+
+    int below(int bound) { return static_cast<int>(next() % static_cast<uint32_t>(bound)); }
+    double between(double low, double high) { return low + (high - low) * (next() / static_cast<double>(1 << 24)); }
+};
+
+// A frozen graph of stationCount stations and a few lines, each a random run of
+// stations ridden both ways. Lines share stations and hops, so there are parallel
+// edges, real interchanges and (Red Line to Red Branch) free changes
+static void buildRandomGraph(MetroGraph& graph, TestRandom& random, int stationCount) {
+    static const char* const lineNames[] = {"Red Line", "Blue Line", "Yellow Line", "Red Branch"};
+    for (int id = 1; id <= stationCount; id++) {
+        graph.addStation(MetroStation(id, "S" + std::to_string(id), "Station " + std::to_string(id),
+                                      28.5 + random.between(0, 0.2), 77.1 + random.between(0, 0.2)));
+    }
+    int lineCount = 2 + random.below(3);
+    for (int line = 1; line <= lineCount; line++) {
+        graph.addLine(MetroLine(line, lineNames[line - 1], "#00000" + std::to_string(line)));
+        int length = 3 + random.below(stationCount - 2);
+        int station = 1 + random.below(stationCount);
+        for (int hop = 0; hop < length; hop++) {
+            int next = 1 + random.below(stationCount);
+            if (next == station) {
+                continue;
+            }
+            double distance = random.between(0.5, 3.0);
+            double time = distance * random.between(1.5, 3.0);
+            graph.addEdge(MetroEdge(station, next, line, distance, time));
+            graph.addEdge(MetroEdge(next, station, line, distance, time));
+            station = next;
+        }
+    }
+    graph.freeze();
+}
+
+static bool sameCost(double expected, double actual) {
+    return std::fabs(expected - actual) <= 1e-9 * std::max(1.0, std::fabs(expected));
+}
+
+// The contraction hierarchy and the route table give Dijkstra's cost for every
+// pair of stations, by distance and by time
+static void testPrecomputedEnginesMatchDijkstra() {
+    const SearchAlgorithm engines[] = {SearchAlgorithm::ContractionHierarchy, SearchAlgorithm::RouteTable};
+    TestRandom random(2024);
+    for (int round = 0; round < 60; round++) {
+        MetroGraph graph;
+        buildRandomGraph(graph, random, 6 + random.below(10));
+        MetroPathFinder finder(graph);
+        finder.buildContractionHierarchies();
+        CHECK(finder.hasContractionHierarchies());
+        std::unique_ptr<RouteTable> table(new RouteTable());
+        CHECK(table->loadFromBuffer(RouteTable::build(graph), graph));
+        finder.setRouteTable(std::move(table));
+
+        std::vector<int> ids = graph.getAllStationIds();
+        for (int sourceId : ids) {
+            for (int targetId : ids) {
+                finder.setSearchAlgorithm(SearchAlgorithm::Dijkstra);
+                MetroPath shortest = finder.findShortestPath(sourceId, targetId);
+                MetroPath fastest = finder.findFastestPath(sourceId, targetId);
+                for (SearchAlgorithm engine : engines) {
+                    finder.setSearchAlgorithm(engine);
+                    MetroPath byDistance = finder.findShortestPath(sourceId, targetId);
+                    CHECK(byDistance.stationIds.empty() == shortest.stationIds.empty());
+                    CHECK(sameCost(shortest.totalDistance, byDistance.totalDistance));
+                    MetroPath byTime = finder.findFastestPath(sourceId, targetId);
+                    CHECK(byTime.stationIds.empty() == fastest.stationIds.empty());
+                    CHECK(sameCost(fastest.totalTime, byTime.totalTime));
+                }
+            }
+        }
+    }
+}
+
+int main() {
+    testPrecomputedEnginesMatchDijkstra();
+    return testResult();
+}
@@ -0,0 +1,65 @@
+#include "query_workspace.h"
+#include "test_support.h"
+#include <cstdint>
+#include <vector>
+
+// Pops of a search-like run: every push is at or above the last cost popped, from
+// start up to about start + span. Returns the popped stations in order.
+template <typename Queue>
+static std::vector<int> drain(double resolution, double start, double span) {
+    QueryWorkspace workspace;
+    std::vector<int> order;
+    Queue queue(workspace, resolution);
+    uint32_t seed = 12345;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / static_cast<double>(1 << 24);
+    };
+    int nextStation = 0;
+    for (int i = 0; i < 20; i++) {
+        queue.push(DijkstraNode(nextStation++, start + random() * span, -1, 0));
+    }
+    while (!queue.empty()) {
+        DijkstraNode node = queue.pop();
+        order.push_back(node.stationId);
+        if (nextStation < 2000) {
+            for (int i = 0; i < 2; i++) {
+                queue.push(DijkstraNode(nextStation++, node.cost + random() * span * 0.1, node.stationId, 0));
+            }
+        }
+    }
+    return order;
+}
+
+// Bucketed pops come out in the binary heap's order at any resolution, including
+// keys past the last bucket and resolutions that leave a plain heap
+static void testMatchesBinaryHeap() {
+    const double resolutions[] = {1.0, 0.01, 0.001, 1e-9, 0.0, -1.0};
+    const double starts[] = {0.0, 1e6};
+    for (double resolution : resolutions) {
+        for (double start : starts) {
+            std::vector<int> expected = drain<BinaryHeapQueue>(resolution, start, 100.0);
+            CHECK(drain<BucketQueue>(resolution, start, 100.0) == expected);
+        }
+    }
+}
+
+// A tiny resolution keeps the bucket array at its cap
+static void testBucketCountIsBounded() {
+    QueryWorkspace workspace;
+    {
+        BucketQueue queue(workspace, 1e-12);
+        queue.push(DijkstraNode(0, 1.0, -1, 0));
+        queue.push(DijkstraNode(1, 1e9, -1, 0));
+        CHECK(queue.pop().stationId == 0);
+        CHECK(queue.pop().stationId == 1);
+        CHECK(queue.empty());
+    }
+    CHECK(workspace.buckets.size() <= BucketQueue::MAX_BUCKETS);
+}
+
+int main() {
+    testMatchesBinaryHeap();
+    testBucketCountIsBounded();
+    return testResult();
+}
@@ -0,0 +1,79 @@
+#include "task_pool.h"
+#include "test_support.h"
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Every task of every batch runs exactly once, batch after batch on the same workers
+static void testRunsEachTaskOnce() {
+    TaskPool pool(3);
+    for (int round = 0; round < 200; round++) {
+        std::vector<std::atomic<int>> runs(round % 17 + 1);
+        pool.run(runs.size(), [&runs](size_t task) { runs[task]++; });
+        bool once = true;
+        for (const std::atomic<int>& count : runs) {
+            once = once && count == 1;
+        }
+        CHECK(once);
+    }
+}
+
+// Batches from several callers at once share the workers and all finish
+static void testConcurrentCallers() {
+    TaskPool pool(2);
+    std::atomic<long> total(0);
+    std::vector<std::thread> callers;
+    for (int caller = 0; caller < 4; caller++) {
+        callers.emplace_back([&pool, &total]() {
+            for (int round = 0; round < 100; round++) {
+                pool.run(8, [&total](size_t task) { total += static_cast<long>(task); });
+            }
+        });
+    }
+    for (std::thread& caller : callers) {
+        caller.join();
+    }
+    CHECK(total == 4 * 100 * 28);
+}
+
+// The first failing task in task order is rethrown, after every task has run
+static void testRethrowsFirstError() {
+    TaskPool pool(3);
+    std::atomic<int> runs(0);
+    std::string message;
+    try {
+        pool.run(16, [&runs](size_t task) {
+            runs++;
+            if (task == 5 || task == 11) {
+                throw std::runtime_error("task " + std::to_string(task));
+            }
+        });
+    } catch (const std::runtime_error& error) {
+        message = error.what();
+    }
+    CHECK(message == "task 5");
+    CHECK(runs == 16);
+}
+
+// A thread count of one keeps the batch on the calling thread
+static void testCallerOnly() {
+    TaskPool pool(3);
+    std::thread::id caller = std::this_thread::get_id();
+    std::atomic<int> elsewhere(0);
+    pool.run(32, [&](size_t) {
+        if (std::this_thread::get_id() != caller) {
+            elsewhere++;
+        }
+    }, 1);
+    CHECK(elsewhere == 0);
+}
+
+int main() {
+    testRunsEachTaskOnce();
+    testConcurrentCallers();
+    testRethrowsFirstError();
+    testCallerOnly();
+    return testResult();
+}
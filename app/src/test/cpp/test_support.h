@@ -0,0 +1,77 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <android/asset_manager.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Failed checks are reported and counted; each test's main returns testResult()
+inline int& failedChecks() {
+    static int count = 0;
+    return count;
+}
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failedChecks()++;                                                              \
+        }                                                                                  \
+    } while (0)
+
+inline int testResult() {
+    if (failedChecks() > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failedChecks());
+        return 1;
+    }
+    return 0;
+}
+
+// GTFS files in a temporary directory, read by the parser through the host asset
+// manager; removed again when the feed goes out of scope
+class TestFeed {
+private:
+    std::string root;
+    std::vector<std::string> paths;
+
+public:
+    TestFeed() {
+        const char* tmp = std::getenv("TMPDIR");
+        std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/metro_feed_XXXXXX";
+        if (!mkdtemp(&pattern[0])) {
+            throw std::runtime_error("Failed to create " + pattern);
+        }
+        root = pattern;
+        mkdir((root + "/DMRC_GTFS").c_str(), 0700);
+    }
+
+    ~TestFeed() {
+        for (const std::string& path : paths) {
+            unlink(path.c_str());
+        }
+        rmdir((root + "/DMRC_GTFS").c_str());
+        rmdir(root.c_str());
+    }
+
+    TestFeed(const TestFeed&) = delete;
+    TestFeed& operator=(const TestFeed&) = delete;
+
+    // Write DMRC_GTFS/filename
+    void write(const std::string& filename, const std::string& content) {
+        std::string path = root + "/DMRC_GTFS/" + filename;
+        std::ofstream(path, std::ios::binary) << content;
+        paths.push_back(path);
+    }
+
+    AAssetManager* assets() const {
+        return reinterpret_cast<AAssetManager*>(const_cast<char*>(root.c_str()));
+    }
+};
+
+#endif // TEST_SUPPORT_H
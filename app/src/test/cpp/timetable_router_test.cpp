@@ -0,0 +1,120 @@
+#include "connection_scan.h"
+#include "metro_graph.h"
+#include "raptor_router.h"
+#include "test_support.h"
+#include "timetable.h"
+#include <string>
+#include <vector>
+
+static const int HOUR = 3600;
+static const int MINUTE = 60;
+
+// Add a trip over stopIds leaving the first stop at start, hopMinutes per hop with a
+// 30 second dwell at every stop in between
+static void addTrip(Timetable& timetable, int routeId, int serviceIndex, const std::vector<int>& stopIds,
+                    int start, int hopMinutes) {
+    TimetableTrip trip;
+    trip.routeId = routeId;
+    trip.serviceIndex = serviceIndex;
+    int time = start;
+    for (size_t i = 0; i < stopIds.size(); i++) {
+        trip.stopIds.push_back(stopIds[i]);
+        trip.arrivalTimes.push_back(time);
+        time += i == 0 || i + 1 == stopIds.size() ? 0 : 30;
+        trip.departureTimes.push_back(time);
+        time += hopMinutes * MINUTE;
+    }
+    timetable.trips.push_back(trip);
+}
+
+// Five stations on three lines:
+//   Red 1-2-3 every 20 minutes all week, and a last train at 23:50 reaching 3 after midnight
+//   Blue 3-4-5 every half hour on weekdays only
+//   Green 2-5 hourly on Sundays only
+static void buildNetwork(MetroGraph& graph, Timetable& timetable) {
+    for (int id = 1; id <= 5; id++) {
+        graph.addStation(MetroStation(id, "S" + std::to_string(id), "Station " + std::to_string(id),
+                                      28.6 + id * 0.01, 77.2));
+    }
+    graph.addLine(MetroLine(1, "Red Line", "#FF0000"));
+    graph.addLine(MetroLine(2, "Blue Line", "#0000FF"));
+    graph.addLine(MetroLine(3, "Green Line", "#00FF00"));
+    const int hops[][3] = {{1, 2, 1}, {2, 3, 1}, {3, 4, 2}, {4, 5, 2}, {2, 5, 3}};
+    for (const auto& hop : hops) {
+        graph.addEdge(MetroEdge(hop[0], hop[1], hop[2], 1.0, 10.0));
+        graph.addEdge(MetroEdge(hop[1], hop[0], hop[2], 1.0, 10.0));
+    }
+    graph.freeze();
+
+    timetable.services.emplace_back("ALL", 0x7F, 20240101, 20251231);
+    timetable.services.emplace_back("WEEKDAY", 0x1F, 20240101, 20251231);
+    timetable.services.emplace_back("SUNDAY", 0x40, 20240101, 20251231);
+    for (int start = 6 * HOUR; start <= 23 * HOUR; start += 20 * MINUTE) {
+        addTrip(timetable, 1, 0, {1, 2, 3}, start, 10);
+        addTrip(timetable, 1, 0, {3, 2, 1}, start + 5 * MINUTE, 10);
+    }
+    addTrip(timetable, 1, 0, {1, 2, 3}, 23 * HOUR + 50 * MINUTE, 15);
+    for (int start = 6 * HOUR; start <= 22 * HOUR; start += 30 * MINUTE) {
+        addTrip(timetable, 2, 1, {3, 4, 5}, start, 8);
+        addTrip(timetable, 2, 1, {5, 4, 3}, start + 10 * MINUTE, 8);
+    }
+    for (int start = 7 * HOUR; start <= 21 * HOUR; start += HOUR) {
+        addTrip(timetable, 3, 2, {2, 5}, start, 12);
+        addTrip(timetable, 3, 2, {5, 2}, start + 30 * MINUTE, 12);
+    }
+}
+
+// RAPTOR (with enough rounds for any journey here) and connection scan arrive at
+// the same time for every pair, day and departure time, including after midnight
+static void testEnginesAgree() {
+    MetroGraph graph;
+    Timetable timetable;
+    buildNetwork(graph, timetable);
+    RaptorRouter raptor(timetable, graph);
+    ConnectionScanRouter scan(timetable, graph);
+
+    int reached = 0;
+    for (int day = 0; day < 7; day++) {
+        for (int departure = 0; departure < 24 * HOUR; departure += 7 * MINUTE) {
+            for (int sourceId = 1; sourceId <= 5; sourceId++) {
+                for (int targetId = 1; targetId <= 5; targetId++) {
+                    TimetableJourney byRounds = raptor.findEarliestArrival(sourceId, targetId, departure, day, 10);
+                    TimetableJourney byScan = scan.findEarliestArrival(sourceId, targetId, departure, day);
+                    CHECK(byRounds.arrivalTime == byScan.arrivalTime);
+                    reached += byScan.arrivalTime >= 0 ? 1 : 0;
+                }
+            }
+        }
+    }
+    CHECK(reached > 0);
+}
+
+// A trip running past midnight is caught the next morning, and a masked service
+// doesn't run on days outside its weekdays
+static void testCalendarEdges() {
+    MetroGraph graph;
+    Timetable timetable;
+    buildNetwork(graph, timetable);
+    RaptorRouter raptor(timetable, graph);
+    ConnectionScanRouter scan(timetable, graph);
+
+    // Tuesday 00:05 at 2: Monday's 23:50 train left 2 at 00:05:30 and reaches 3 at 00:20:30
+    int afterMidnight = 5 * MINUTE;
+    int expected = 20 * MINUTE + 30;
+    CHECK(raptor.findEarliestArrival(2, 3, afterMidnight, 1).arrivalTime == expected);
+    CHECK(scan.findEarliestArrival(2, 3, afterMidnight, 1).arrivalTime == expected);
+
+    // Blue runs on weekdays only, so on Saturday 4 can't be reached; on Sunday Green
+    // reaches 5 but still not 4
+    CHECK(raptor.findEarliestArrival(3, 4, 12 * HOUR, 5).arrivalTime == -1);
+    CHECK(scan.findEarliestArrival(3, 4, 12 * HOUR, 5).arrivalTime == -1);
+    CHECK(scan.findEarliestArrival(3, 4, 12 * HOUR, 4).arrivalTime == 12 * HOUR + 8 * MINUTE);
+    CHECK(scan.findEarliestArrival(2, 5, 12 * HOUR, 6).arrivalTime == 12 * HOUR + 12 * MINUTE);
+    CHECK(scan.findEarliestArrival(2, 4, 12 * HOUR, 6).arrivalTime == -1);
+}
+
+int main() {
+    testEnginesAgree();
+    testCalendarEdges();
+    return testResult();
+}